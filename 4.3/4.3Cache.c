@@ -1,232 +1,1663 @@
 #include "4.3Cache.h"
+#include <sys/mman.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
-uint8_t L1Cache[L1_SIZE];
-uint8_t L2Cache[L2_SIZE];
-uint8_t DRAM[DRAM_SIZE];
-uint32_t time;
-CacheL1 SimpleCacheL1;
-CacheL2 SimpleCacheL2;
+Simulator DefaultSimulator;    // behind the read()/write() interface
+static AccessHook Hook;        // sees every read()/write(), e.g. to capture a trace
+static void *HookContext;
 
 
+/**************** Configuration ***************/
+CacheConfig getDefaultConfig() {
+    CacheConfig config;
+
+    config.blockSize = BLOCK_SIZE;
+    config.dramSize = DRAM_SIZE;
+    config.dramReadTime = DRAM_READ_TIME;
+    config.dramWriteTime = DRAM_WRITE_TIME;
+    config.classifyMisses = 0;
+    config.latencyHistograms = 0;
+    config.tagOnly = 0;
+    config.cores = CORES;
+    config.levels = LEVELS;
+    config.transferTime = TRANSFER_TIME;
+    config.inclusion = INCLUSION;
+    config.timing = TIMING;
+    config.pages = PAGES;
+    config.L1.size = L1_SIZE;
+    config.L1.ways = L1_WAYS;
+    config.L1.replacement = L1_REPLACEMENT;
+    config.L1.readTime = L1_READ_TIME;
+    config.L1.writeTime = L1_WRITE_TIME;
+    config.L1.prefetcher = L1_PREFETCHER;
+    config.L1.prefetchDegree = PREFETCH_DEGREE;
+    config.L1.writeBuffer = WRITE_BUFFER_ENTRIES;
+    config.L1.victimEntries = VICTIM_ENTRIES;
+    config.L1.writePolicy = WRITE_POLICY;
+    config.L1.writeMiss = WRITE_MISS_POLICY;
+    config.L1.mshrs = L1_MSHRS;
+    config.L2.size = L2_SIZE;
+    config.L2.ways = L2_WAYS;
+    config.L2.replacement = L2_REPLACEMENT;
+    config.L2.readTime = L2_READ_TIME;
+    config.L2.writeTime = L2_WRITE_TIME;
+    config.L2.prefetcher = L2_PREFETCHER;
+    config.L2.prefetchDegree = PREFETCH_DEGREE;
+    config.L2.writeBuffer = WRITE_BUFFER_ENTRIES;
+    config.L2.victimEntries = VICTIM_ENTRIES;
+    config.L2.writePolicy = WRITE_POLICY;
+    config.L2.writeMiss = WRITE_MISS_POLICY;
+    config.L2.mshrs = L2_MSHRS;
+    return config;
+}
+
+typedef struct ConfigField {
+    const char *name;
+    size_t offset;
+    int (*byName)(const char *);        // for fields that take a name, NULL otherwise
+    const char *(*toName)(uint32_t);
+} ConfigField;
+
+#define FIELD(name, member) { name, offsetof(CacheConfig, member), NULL, NULL }
+#define NAMED_FIELD(name, member, kind) { name, offsetof(CacheConfig, member), get##kind##ByName, get##kind##Name }
+
+/* Every option in config files, -s and the sweep CSV, in print order */
+static const ConfigField ConfigFields[] = {
+    FIELD("block_size", blockSize),
+    FIELD("dram_size", dramSize),
+    FIELD("dram_read_time", dramReadTime),
+    FIELD("dram_write_time", dramWriteTime),
+    FIELD("classify_misses", classifyMisses),
+    FIELD("latency_histograms", latencyHistograms),
+    FIELD("tag_only", tagOnly),
+    FIELD("cores", cores),
+    FIELD("levels", levels),
+    FIELD("transfer_time", transferTime),
+    NAMED_FIELD("inclusion", inclusion, Inclusion),
+    NAMED_FIELD("timing", timing, Timing),
+    NAMED_FIELD("pages", pages, Pages),
+    FIELD("l1_size", L1.size),
+    FIELD("l1_ways", L1.ways),
+    NAMED_FIELD("l1_replacement", L1.replacement, Replacement),
+    FIELD("l1_read_time", L1.readTime),
+    FIELD("l1_write_time", L1.writeTime),
+    NAMED_FIELD("l1_prefetcher", L1.prefetcher, Prefetcher),
+    FIELD("l1_prefetch_degree", L1.prefetchDegree),
+    FIELD("l1_write_buffer", L1.writeBuffer),
+    FIELD("l1_victim_entries", L1.victimEntries),
+    NAMED_FIELD("l1_write_policy", L1.writePolicy, WritePolicy),
+    NAMED_FIELD("l1_write_miss", L1.writeMiss, WriteMiss),
+    FIELD("l1_mshrs", L1.mshrs),
+    FIELD("l2_size", L2.size),
+    FIELD("l2_ways", L2.ways),
+    NAMED_FIELD("l2_replacement", L2.replacement, Replacement),
+    FIELD("l2_read_time", L2.readTime),
+    FIELD("l2_write_time", L2.writeTime),
+    NAMED_FIELD("l2_prefetcher", L2.prefetcher, Prefetcher),
+    FIELD("l2_prefetch_degree", L2.prefetchDegree),
+    FIELD("l2_write_buffer", L2.writeBuffer),
+    FIELD("l2_victim_entries", L2.victimEntries),
+    NAMED_FIELD("l2_write_policy", L2.writePolicy, WritePolicy),
+    NAMED_FIELD("l2_write_miss", L2.writeMiss, WriteMiss),
+    FIELD("l2_mshrs", L2.mshrs),
+    { NULL, 0, NULL, NULL }
+};
+
+static uint32_t *getConfigField(const CacheConfig *config, const ConfigField *Field) {
+    return (uint32_t *)((uint8_t *)config + Field->offset);
+}
+
+static const ConfigField *findConfigField(const char *name) {
+    for (const ConfigField *Field = ConfigFields; Field->name != NULL; Field++)
+        if (strcmp(name, Field->name) == 0)
+            return Field;
+    return NULL;
+}
+
+/* Sets one field by its config file / command line name, -1 if unknown */
+int setConfigValue(CacheConfig *config, const char *name, uint32_t value) {
+    const ConfigField *Field = findConfigField(name);
+
+    if (Field == NULL)
+        return -1;
+    *getConfigField(config, Field) = value;
+    return 0;
+}
+
+/* Index of name in names, which may be followed by a line ending or a space, -1 if absent */
+static int findName(const char *name, const char *const *names, int count) {
+    for (int i = 0; i < count; i++) {
+        size_t length = strlen(names[i]);
+        if (strncmp(name, names[i], length) == 0 &&
+            (name[length] == '\0' || name[length] == '\n' || name[length] == '\r' || name[length] == ' '))
+            return i;
+    }
+    return -1;
+}
+
+const char *ReplacementNames[NUM_REPLACEMENTS] = { "lru", "plru", "fifo", "random", "srrip" };
+const char *WritePolicyNames[NUM_WRITE_POLICIES] = { "write_back", "write_through" };
+const char *WriteMissNames[NUM_WRITE_MISS_POLICIES] = { "allocate", "no_allocate" };
+const char *InclusionNames[NUM_INCLUSIONS] = { "nine", "inclusive", "exclusive" };
+const char *TimingNames[NUM_TIMINGS] = { "additive", "event" };
+const char *PagesNames[NUM_ARENA_PAGES] = { "normal", "thp", "hugetlb" };
+const char *PrefetcherNames[NUM_PREFETCHERS] = { "none", "next_line", "stride", "stream" };
+
+int getReplacementByName(const char *name) { return findName(name, ReplacementNames, NUM_REPLACEMENTS); }
+
+const char *getReplacementName(uint32_t replacement) {
+    return replacement < NUM_REPLACEMENTS ? ReplacementNames[replacement] : "unknown";
+}
+
+int getWritePolicyByName(const char *name) { return findName(name, WritePolicyNames, NUM_WRITE_POLICIES); }
+
+const char *getWritePolicyName(uint32_t policy) {
+    return policy < NUM_WRITE_POLICIES ? WritePolicyNames[policy] : "unknown";
+}
+
+int getWriteMissByName(const char *name) { return findName(name, WriteMissNames, NUM_WRITE_MISS_POLICIES); }
+
+const char *getWriteMissName(uint32_t policy) {
+    return policy < NUM_WRITE_MISS_POLICIES ? WriteMissNames[policy] : "unknown";
+}
+
+int getInclusionByName(const char *name) { return findName(name, InclusionNames, NUM_INCLUSIONS); }
+
+const char *getInclusionName(uint32_t inclusion) {
+    return inclusion < NUM_INCLUSIONS ? InclusionNames[inclusion] : "unknown";
+}
+
+int getTimingByName(const char *name) { return findName(name, TimingNames, NUM_TIMINGS); }
+
+const char *getTimingName(uint32_t timing) {
+    return timing < NUM_TIMINGS ? TimingNames[timing] : "unknown";
+}
+
+int getPagesByName(const char *name) { return findName(name, PagesNames, NUM_ARENA_PAGES); }
+
+const char *getPagesName(uint32_t pages) {
+    return pages < NUM_ARENA_PAGES ? PagesNames[pages] : "unknown";
+}
+
+int getPrefetcherByName(const char *name) { return findName(name, PrefetcherNames, NUM_PREFETCHERS); }
+
+const char *getPrefetcherName(uint32_t type) {
+    return type < NUM_PREFETCHERS ? PrefetcherNames[type] : "unknown";
+}
+
+/* value may be decimal, 0x hex or, for policies, a name */
+int setConfigOption(CacheConfig *config, const char *name, const char *text) {
+    const ConfigField *Field = findConfigField(name);
+    char *end;
+
+    if (Field == NULL)
+        return -1;
+    int named = Field->byName != NULL ? Field->byName(text) : -1;
+    if (named >= 0)
+        return setConfigValue(config, name, (uint32_t)named);
+
+    unsigned long value = strtoul(text, &end, 0);
+    if (*text == '\0' || (*end != '\0' && *end != '\n' && *end != '\r' && *end != ' ') || value > UINT32_MAX)
+        return -1;
+    return setConfigValue(config, name, (uint32_t)value);
+}
+
+/* Parses "name=value" */
+int parseConfigOption(CacheConfig *config, const char *option) {
+    char name[64];
+    const char *equals = strchr(option, '=');
+
+    if (equals == NULL || equals == option || (size_t)(equals - option) >= sizeof(name))
+        return -1;
+    memcpy(name, option, equals - option);
+    name[equals - option] = '\0';
+    return setConfigOption(config, name, equals + 1);
+}
+
+/* Several options on one line, separated by spaces, tabs or commas */
+int parseConfigLine(CacheConfig *config, char *line) {
+    for (char *option = strtok(line, " \t,\r\n"); option != NULL; option = strtok(NULL, " \t,\r\n")) {
+        if (parseConfigOption(config, option) != 0) {
+            fprintf(stderr, "bad option %s\n", option);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* One "name=value" per line, blank lines and '#' comments are skipped */
+int loadConfigFile(CacheConfig *config, const char *path) {
+    char line[256];
+    int lineNumber = 0;
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *start = line;
+        lineNumber++;
+        while (*start == ' ' || *start == '\t')
+            start++;
+        if (*start == '#' || *start == '\n' || *start == '\r' || *start == '\0')
+            continue;
+        if (parseConfigOption(config, start) != 0) {
+            fprintf(stderr, "%s:%d: bad option %s", path, lineNumber, start);
+            fclose(file);
+            return -1;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+static void printConfigValue(FILE *out, const CacheConfig *config, const ConfigField *Field) {
+    if (Field->toName != NULL)
+        fprintf(out, "%s", Field->toName(*getConfigField(config, Field)));
+    else
+        fprintf(out, "%u", *getConfigField(config, Field));
+}
+
+void printConfig(FILE *out, const CacheConfig *config) {
+    for (const ConfigField *Field = ConfigFields; Field->name != NULL; Field++) {
+        fprintf(out, "%s=", Field->name);
+        printConfigValue(out, config, Field);
+        fprintf(out, "\n");
+    }
+}
+
+/* Column names and values without a line ending, so stats can follow */
+void printConfigCSVHeader(FILE *out) {
+    for (const ConfigField *Field = ConfigFields; Field->name != NULL; Field++)
+        fprintf(out, "%s%s", Field == ConfigFields ? "" : ",", Field->name);
+}
+
+void printConfigCSV(FILE *out, const CacheConfig *config) {
+    for (const ConfigField *Field = ConfigFields; Field->name != NULL; Field++) {
+        if (Field != ConfigFields)
+            fprintf(out, ",");
+        printConfigValue(out, config, Field);
+    }
+}
+
 /**************** Time Manipulation ***************/
-void resetTime() { time = 0; }
+static void resetEventTiming(Simulator *);
+
+void resetTime() {
+    DefaultSimulator.time = 0;
+    resetEventTiming(&DefaultSimulator);
+    DefaultSimulator.statsTime = 0;         // the report counts from here now
+    DefaultSimulator.statsCycles = 0;
+}
+
+uint32_t getTime() { return (uint32_t)DefaultSimulator.time; }
 
-uint32_t getTime() { return time; }
+/* The event timing clock, 0 unless timing is TIMING_EVENT */
+uint32_t getCycles() { return (uint32_t)DefaultSimulator.cycles; }
 
 /****************  RAM memory (byte addressable) ***************/
-void accessDRAM(uint32_t address, uint8_t *data, uint32_t mode) {
+/* size is a block, or a word written through or around the caches */
+static void accessMemory(Simulator *Sim, uint64_t address, uint8_t *data, uint32_t mode, uint32_t size) {
 
-    if (address >= DRAM_SIZE - WORD_SIZE + 1)
+    if (Sim->config.dramSize != 0 && address >= Sim->config.dramSize - WORD_SIZE + 1)
         exit(-1);
 
+    Sim->memoryStats.accesses[mode]++;
+    Sim->memoryStats.bytes[mode] += size;
+
     if (mode == MODE_READ) {
-        memcpy(data, &(DRAM[address]), BLOCK_SIZE);
-        time += DRAM_READ_TIME;
+        if (!Sim->config.tagOnly)
+            readMemory(&Sim->DRAM, address, data, size);
+        Sim->time += Sim->config.dramReadTime;
     }
 
     if (mode == MODE_WRITE) {
-        memcpy(&(DRAM[address]), data, BLOCK_SIZE);
-        time += DRAM_WRITE_TIME;
+        if (!Sim->config.tagOnly && writeMemory(&Sim->DRAM, address, data, size) != 0) {
+            fprintf(stderr, "accessDRAM: out of memory\n");
+            exit(-1);
+        }
+        Sim->time += Sim->config.dramWriteTime;
     }
 }
 
+void accessDRAM(uint32_t address, uint8_t *data, uint32_t mode) {
+    accessMemory(&DefaultSimulator, address, data, mode, DefaultSimulator.config.blockSize);
+}
+
 /*********************** Caches *************************/
+static int isPowerOfTwo(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+/* The arrays go back with the simulator's arena */
+static void freeLevel(CacheLevel *Cache) {
+    freeMshrFile(&Cache->mshrs);
+    freeClassifier(Cache->classifier);
+}
+
+static int setupLevel(CacheLevel *Cache, const LevelConfig *level, const CacheConfig *config, Arena *Pool) {
+    uint32_t blockSize = config->blockSize;
+    CacheLevel Level;
+
+    if (!isPowerOfTwo(level->size) || level->size < blockSize || level->replacement >= NUM_REPLACEMENTS ||
+        level->prefetcher >= NUM_PREFETCHERS || level->writeBuffer > MAX_BUFFER_ENTRIES ||
+        level->victimEntries > MAX_BUFFER_ENTRIES || level->writePolicy >= NUM_WRITE_POLICIES ||
+        level->writeMiss >= NUM_WRITE_MISS_POLICIES ||
+        (config->timing == TIMING_EVENT && (level->mshrs < 1 || level->mshrs > MAX_MSHRS)))
+        return -1;
+
+    memset(&Level, 0, sizeof(Level));
+    Level.size = level->size;
+    Level.numLines = level->size / blockSize;
+    Level.ways = level->ways == 0 ? Level.numLines : level->ways;
+    if (!isPowerOfTwo(Level.ways) || Level.ways > Level.numLines)
+        return -1;
+    Level.replacement = level->replacement;
+    Level.numSets = Level.numLines / Level.ways;
+    Level.offsetBits = getNumBits(blockSize);
+    Level.tagShift = Level.offsetBits + getNumBits(Level.numSets);
+    Level.offsetMask = createBitMask(Level.offsetBits);
+    Level.indexMask = createBitMask(getNumBits(Level.numSets));
+    Level.readTime = level->readTime;
+    Level.writeTime = level->writeTime;
+    Level.writePolicy = level->writePolicy;
+    Level.writeMiss = level->writeMiss;
+    Level.plruWords = (Level.ways + 63) / 64;
+    Level.tags = allocArena(Pool, Level.numLines * sizeof(uint64_t));
+    Level.lines = allocArena(Pool, Level.numLines * sizeof(CacheLine));
+    Level.sets = allocArena(Pool, Level.numSets * sizeof(CacheSet));
+    Level.plru = allocArena(Pool, (size_t)Level.numSets * Level.plruWords * sizeof(uint64_t));
+    if (!config->tagOnly)
+        Level.data = allocArena(Pool, level->size);
+    if (config->classifyMisses)
+        Level.classifier = createClassifier(Level.numLines);
+    initPrefetcher(&Level.prefetch, level->prefetcher, level->prefetchDegree);
+    if (level->prefetcher != PREFETCH_NONE)
+        Level.ready = allocArena(Pool, Level.numLines * sizeof(uint64_t));
+    Level.writeBuffer.entries = level->writeBuffer;
+    if (level->writeBuffer)
+        Level.writeBuffer.done = allocArena(Pool, level->writeBuffer * sizeof(uint64_t));
+    Level.victims.entries = level->victimEntries;
+    if (level->victimEntries) {
+        Level.victims.blocks = allocArena(Pool, level->victimEntries * sizeof(uint64_t));
+        Level.victims.dirty = allocArena(Pool, level->victimEntries);
+        if (!config->tagOnly)
+            Level.victims.data = allocArena(Pool, (size_t)level->victimEntries * blockSize);
+    }
+    int noMshrs = config->timing == TIMING_EVENT && initMshrFile(&Level.mshrs, level->mshrs) != 0;
+    if (Level.tags == NULL || Level.lines == NULL || Level.sets == NULL || Level.plru == NULL ||
+        (!config->tagOnly && Level.data == NULL) || (config->classifyMisses && Level.classifier == NULL) ||
+        (level->prefetcher != PREFETCH_NONE && Level.ready == NULL) ||
+        (level->writeBuffer && Level.writeBuffer.done == NULL) ||
+        (level->victimEntries && (Level.victims.blocks == NULL || Level.victims.dirty == NULL ||
+                                  (!config->tagOnly && Level.victims.data == NULL))) || noMshrs) {
+        freeLevel(&Level);
+        return -1;
+    }
+
+    freeLevel(Cache);
+    *Cache = Level;
+    return 0;
+}
+
+static void linkLevels(Simulator *Sim) {
+    for (uint32_t core = 0; core < Sim->numCores; core++) {
+        Sim->L1[core].sim = Sim;
+        Sim->L1[core].next = Sim->config.levels > 1 ? &Sim->L2 : NULL;
+        Sim->L1[core].core = core;
+        Sim->L1[core].coherent = Sim->numCores > 1;
+        Sim->L1[core].exclusiveBelow = Sim->config.levels > 1 && Sim->config.inclusion == INCLUSION_EXCLUSIVE;
+    }
+    Sim->L2.sim = Sim;
+    Sim->L2.next = NULL;
+    Sim->L2.inclusiveAbove = Sim->config.inclusion == INCLUSION_INCLUSIVE;
+}
+
+/* Validates the geometry and allocates every array of Sim. Sizes must be
+   powers of two; on failure Sim is left untouched. */
+int setupSimulator(Simulator *Sim, const CacheConfig *config) {
+    Simulator New;
+
+    if (!isPowerOfTwo(config->blockSize) || config->blockSize < WORD_SIZE || config->blockSize > MAX_BLOCK_SIZE ||
+        (config->dramSize != 0 && (!isPowerOfTwo(config->dramSize) || config->dramSize < config->blockSize))) {
+        fprintf(stderr, "setupSimulator: invalid block or DRAM size\n");
+        return -1;
+    }
+    if (config->cores < 1 || config->cores > MAX_CORES) {
+        fprintf(stderr, "setupSimulator: cores must be 1 to %d\n", MAX_CORES);
+        return -1;
+    }
+    if (config->levels < 1 || config->levels > MAX_LEVELS) {
+        fprintf(stderr, "setupSimulator: levels must be 1 to %d\n", MAX_LEVELS);
+        return -1;
+    }
+    if (config->inclusion >= NUM_INCLUSIONS) {
+        fprintf(stderr, "setupSimulator: unknown inclusion policy\n");
+        return -1;
+    }
+    if (config->timing >= NUM_TIMINGS) {
+        fprintf(stderr, "setupSimulator: unknown timing model\n");
+        return -1;
+    }
+    if (config->pages >= NUM_ARENA_PAGES) {
+        fprintf(stderr, "setupSimulator: unknown page kind\n");
+        return -1;
+    }
+    if (config->cores > 1 && config->L1.victimEntries) {
+        fprintf(stderr, "setupSimulator: L1 victim caches are not snooped, use one core\n");
+        return -1;
+    }
+
+    memset(&New, 0, sizeof(New));
+    New.numCores = config->cores;
+    initArena(&New.arena, config->pages);
+    int failed = !config->tagOnly && initMemory(&New.DRAM, config->pages) != 0;
+    for (uint32_t core = 0; core < New.numCores && !failed; core++)
+        failed = setupLevel(&New.L1[core], &config->L1, config, &New.arena) != 0;
+    if (config->levels > 1)                             // the L2 config is ignored otherwise
+        failed = failed || setupLevel(&New.L2, &config->L2, config, &New.arena) != 0;
+    if (!failed && config->latencyHistograms)
+        failed = (New.latency = allocArena(&New.arena, sizeof(LatencyStats))) == NULL;
+    if (!failed && config->timing == TIMING_EVENT)     // one event per MSHR at most
+        failed = initEventQueue(&New.events, config->cores * config->L1.mshrs + config->L2.mshrs) != 0;
+    if (failed) {
+        fprintf(stderr, "setupSimulator: invalid cache size or out of memory\n");
+        cleanupSimulator(&New);
+        return -1;
+    }
+
+    cleanupSimulator(Sim);
+    New.config = *config;
+    New.configured = 1;
+    *Sim = New;
+    linkLevels(Sim);
+    return 0;
+}
+
+void cleanupSimulator(Simulator *Sim) {
+    for (uint32_t core = 0; core < MAX_CORES; core++)
+        freeLevel(&Sim->L1[core]);
+    freeLevel(&Sim->L2);
+    freeEventQueue(&Sim->events);
+    freeArena(&Sim->arena);
+    freeMemory(&Sim->DRAM);
+    if (Sim->snapshot != NULL)
+        munmap(Sim->snapshot, Sim->snapshotSize);
+    memset(Sim, 0, sizeof(*Sim));
+}
+
+/* Empties the caches and clears time and statistics, like a fresh run */
+void resetSimulator(Simulator *Sim) {
+    for (uint32_t core = 0; core < Sim->numCores; core++)
+        Sim->L1[core].init = 0;
+    Sim->L2.init = 0;
+    Sim->time = 0;
+    resetEventTiming(Sim);
+    resetSimulatorStats(Sim);
+}
+
+Simulator *createSimulator(const CacheConfig *config) {
+    Simulator *Sim = calloc(1, sizeof(Simulator));
+
+    if (Sim == NULL || setupSimulator(Sim, config) != 0) {
+        free(Sim);
+        return NULL;
+    }
+    return Sim;
+}
+
+void freeSimulator(Simulator *Sim) {
+    if (Sim == NULL)
+        return;
+    cleanupSimulator(Sim);
+    free(Sim);
+}
+
+int configureCaches(const CacheConfig *config) {
+    return setupSimulator(&DefaultSimulator, config);
+}
+
+/* The Cache.h geometry, unless configureCaches() came first */
+static void configureDefault() {
+    if (!DefaultSimulator.configured) {
+        CacheConfig config = getDefaultConfig();
+        if (configureCaches(&config) != 0)
+            exit(-1);
+    }
+}
+
 void initCaches() {
-    SimpleCacheL1.init = 0;
-    SimpleCacheL2.init = 0;
+    configureDefault();
+    for (uint32_t core = 0; core < DefaultSimulator.numCores; core++)
+        DefaultSimulator.L1[core].init = 0;
+    DefaultSimulator.L2.init = 0;
+    resetStats();
+}
+
+void freeCaches() {
+    cleanupSimulator(&DefaultSimulator);
 }
 
 uint32_t createBitMask(uint32_t bits) {
     return ((1 << bits) - 1); 
 }
 
-uint32_t getNumIndexBits(uint32_t cacheSize) {
-    return (uint32_t)log2(cacheSize / BLOCK_SIZE); 
+/* log2 of a power of two */
+uint32_t getNumBits(uint32_t value) {
+    return (uint32_t)__builtin_ctz(value);
+}
+
+uint64_t getTag(const CacheLevel *Cache, uint64_t address) {
+    return address >> Cache->tagShift;
+}
+
+uint32_t getIndex(const CacheLevel *Cache, uint64_t address) {
+    return (uint32_t)(address >> Cache->offsetBits) & Cache->indexMask;
+}
+
+uint32_t getBlockOffset(const CacheLevel *Cache, uint64_t address) {
+    return (uint32_t)address & Cache->offsetMask;
+}
+
+uint64_t getMemAddress(const CacheLevel *Cache, uint64_t address) {
+    return address & ~(uint64_t)Cache->offsetMask;
 }
 
-uint32_t getNumBlockOffsetBits() {
-    return (uint32_t)log2(BLOCK_SIZE); 
+uint64_t getMemAddressFromCacheInfo(const CacheLevel *Cache, uint64_t Tag, uint32_t index) {
+    return (Tag << Cache->tagShift) | ((uint64_t)index << Cache->offsetBits);
 }
 
-uint32_t getTag(uint32_t address, uint32_t cacheSize) {
-    return address >> (getNumBlockOffsetBits() + getNumIndexBits(cacheSize));
+/*********************** Replacement *************************/
+#define NO_WAY UINT32_MAX
+#define SRRIP_MAX 3
+
+/* Back to the state after a reset: everything invalid, way 0 is the
+   least recently used one and the first to be filled. */
+static void resetLevel(CacheLevel *Cache) {
+    for (uint32_t set = 0; set < Cache->numSets; set++) {
+        CacheLine *Lines = &Cache->lines[set * Cache->ways];
+        for (uint32_t way = 0; way < Cache->ways; way++) {
+            Cache->tags[set * Cache->ways + way] = TAG_INVALID;
+            Lines[way].Dirty = 0;
+            Lines[way].RRPV = SRRIP_MAX;
+            Lines[way].Prefetched = 0;
+            Lines[way].Prev = way + 1 < Cache->ways ? way + 1 : NO_WAY;
+            Lines[way].Next = way > 0 ? way - 1 : NO_WAY;
+        }
+        Cache->sets[set].Head = Cache->ways - 1;
+        Cache->sets[set].Tail = 0;
+        Cache->sets[set].Fifo = 0;
+        Cache->sets[set].Filled = 0;
+    }
+    memset(Cache->plru, 0, (size_t)Cache->numSets * Cache->plruWords * sizeof(uint64_t));
+    Cache->random = 0x9E3779B9;
+    resetPrefetcher(&Cache->prefetch);
+    Cache->writeBuffer.head = 0;
+    Cache->writeBuffer.count = 0;
+    Cache->victims.count = 0;
+    Cache->init = 1;
 }
 
-uint32_t getIndex(uint32_t address, uint32_t cacheSize) {
-    return (address >> getNumBlockOffsetBits()) & createBitMask(getNumIndexBits(cacheSize));
+static void moveToFront(CacheLevel *Cache, uint32_t index, uint32_t way) {
+    CacheSet *Set = &Cache->sets[index];
+    CacheLine *Lines = &Cache->lines[index * Cache->ways];
+
+    if (Set->Head == way)
+        return;
+
+    /* unlink, way is not the head so it has a previous one */
+    Lines[Lines[way].Prev].Next = Lines[way].Next;
+    if (Lines[way].Next != NO_WAY)
+        Lines[Lines[way].Next].Prev = Lines[way].Prev;
+    else
+        Set->Tail = Lines[way].Prev;
+
+    Lines[way].Prev = NO_WAY;
+    Lines[way].Next = Set->Head;
+    Lines[Set->Head].Prev = way;
+    Set->Head = way;
 }
 
-uint32_t getNumIndexBitsAssociative(uint32_t cacheSize) {
-    return (uint32_t)log2(cacheSize / BLOCK_SIZE) - 1; 
+/* Tree PLRU: node n has children 2n and 2n + 1, leaves ways..2*ways-1.
+   A node's bit points to the half that should be replaced next. */
+static void touchPLRU(CacheLevel *Cache, uint32_t index, uint32_t way) {
+    uint64_t *Bits = &Cache->plru[(size_t)index * Cache->plruWords];
+    uint32_t node = way + Cache->ways;
+
+    while (node > 1) {
+        uint32_t parent = node >> 1;
+        if (node & 1)
+            Bits[parent >> 6] &= ~(1ULL << (parent & 63));  // right used, replace left
+        else
+            Bits[parent >> 6] |= 1ULL << (parent & 63);     // left used, replace right
+        node = parent;
+    }
 }
 
-uint32_t getTagAssociative(uint32_t address, uint32_t cacheSize) {
-    return address >> (getNumBlockOffsetBits() + getNumIndexBitsAssociative(cacheSize));
-} 
+static uint32_t victimPLRU(CacheLevel *Cache, uint32_t index) {
+    uint64_t *Bits = &Cache->plru[(size_t)index * Cache->plruWords];
+    uint32_t node = 1;
 
-uint32_t getIndexAssociative(uint32_t address, uint32_t cacheSize) {
-    return (address >> getNumBlockOffsetBits()) & createBitMask(getNumIndexBitsAssociative(cacheSize));
+    while (node < Cache->ways)
+        node = 2 * node + (uint32_t)((Bits[node >> 6] >> (node & 63)) & 1);
+    return node - Cache->ways;
 }
 
-uint32_t getBlockOffset(uint32_t address) {
-    return address & createBitMask(getNumBlockOffsetBits());
+static uint32_t victimSRRIP(CacheLevel *Cache, uint32_t index) {
+    CacheLine *Lines = &Cache->lines[index * Cache->ways];
+
+    for (;;) {
+        for (uint32_t way = 0; way < Cache->ways; way++)
+            if (Lines[way].RRPV >= SRRIP_MAX)
+                return way;
+        for (uint32_t way = 0; way < Cache->ways; way++)
+            Lines[way].RRPV++;
+    }
 }
 
-uint32_t getMemAddress(uint32_t address) {
-    uint32_t MemAddress = address >> getNumBlockOffsetBits();
-    MemAddress = MemAddress << getNumBlockOffsetBits();
-    return MemAddress;
+static uint32_t chooseVictim(CacheLevel *Cache, uint32_t index) {
+    uint32_t way;
+
+    switch (Cache->replacement) {
+    case REPLACEMENT_PLRU:
+        return victimPLRU(Cache, index);
+    case REPLACEMENT_FIFO:
+        way = Cache->sets[index].Fifo;
+        Cache->sets[index].Fifo = (way + 1) & (Cache->ways - 1);
+        return way;
+    case REPLACEMENT_RANDOM:
+        Cache->random ^= Cache->random << 13;
+        Cache->random ^= Cache->random >> 17;
+        Cache->random ^= Cache->random << 5;
+        return Cache->random & (Cache->ways - 1);
+    case REPLACEMENT_SRRIP:
+        return victimSRRIP(Cache, index);
+    default:
+        return Cache->sets[index].Tail;
+    }
 }
 
-uint32_t getMemAddressFromCacheInfo(uint32_t Tag, uint32_t index, uint32_t cacheSize) {
-    uint32_t MemAddress;
-    MemAddress = Tag << getNumIndexBits(cacheSize);        
-    MemAddress = MemAddress | index;
-    MemAddress = MemAddress << getNumBlockOffsetBits();
-    return MemAddress; 
+/* Updates the replacement state after way was accessed (hit or fill) */
+static void touchLine(CacheLevel *Cache, uint32_t index, uint32_t way, uint32_t hit) {
+    switch (Cache->replacement) {
+    case REPLACEMENT_LRU:
+        moveToFront(Cache, index, way);
+        break;
+    case REPLACEMENT_PLRU:
+        touchPLRU(Cache, index, way);
+        break;
+    case REPLACEMENT_SRRIP:
+        Cache->lines[index * Cache->ways + way].RRPV = hit ? 0 : SRRIP_MAX - 1;
+        break;
+    default:
+        break;
+    }
 }
 
-uint32_t getMemAddressFromCacheInfoAssociative(uint32_t Tag, uint32_t index, uint32_t cacheSize) {
-    uint32_t MemAddress;
-    MemAddress = Tag << getNumIndexBitsAssociative(cacheSize);        
-    MemAddress = MemAddress | index;
-    MemAddress = MemAddress << getNumBlockOffsetBits();
-    return MemAddress; 
+/*********************** Way lookup *************************/
+
+/* Finds Tag among the ways of a set, NO_WAY if it is not there. Invalid
+   ways hold TAG_INVALID, so one compare covers both the valid bit and the
+   tag, a whole vector of ways at a time, and looking up TAG_INVALID finds
+   the first free way. */
+static inline uint32_t lookupSet(const uint64_t *Tags, uint32_t ways, uint64_t Tag) {
+    uint32_t way = 0;
+
+#if defined(__AVX2__)
+    const __m256i Key = _mm256_set1_epi64x((long long)Tag);
+    for (; way + 4 <= ways; way += 4) {
+        __m256i Ways = _mm256_loadu_si256((const __m256i *)&Tags[way]);
+        uint32_t hits = (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(Ways, Key)));
+        if (hits != 0)
+            return way + (uint32_t)__builtin_ctz(hits);
+    }
+#elif defined(__SSE2__)
+    /* no 64 bit compare in SSE2: both 32 bit halves have to match */
+    const __m128i Key = _mm_set1_epi64x((long long)Tag);
+    for (; way + 2 <= ways; way += 2) {
+        __m128i Equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)&Tags[way]), Key);
+        Equal = _mm_and_si128(Equal, _mm_shuffle_epi32(Equal, _MM_SHUFFLE(2, 3, 0, 1)));
+        uint32_t hits = (uint32_t)_mm_movemask_pd(_mm_castsi128_pd(Equal));
+        if (hits != 0)
+            return way + (uint32_t)__builtin_ctz(hits);
+    }
+#endif
+    for (; way < ways; way++)
+        if (Tags[way] == Tag)
+            return way;
+    return NO_WAY;
 }
 
-/*********************** Cache L1 *************************/
-void accessL1Cache(uint32_t address, uint8_t *data, uint32_t mode) {
+/*********************** Coherence (MESI snooping) *************************/
 
-    uint32_t index, Tag, MemAddress, BlockOffset, CacheBlockIndex, CacheDataIndex;
-    uint8_t TempBlock[BLOCK_SIZE];
+static void accessNextLevel(CacheLevel *, uint64_t, uint8_t *, uint32_t, uint32_t);
 
-    index = getIndex(address, L1_SIZE);
-    Tag = getTag(address, L1_SIZE);
-    MemAddress = getMemAddress(address);
-    BlockOffset = getBlockOffset(address);
-    CacheBlockIndex = index * BLOCK_SIZE;
-    CacheDataIndex = CacheBlockIndex + BlockOffset;
+/* The private L1s of a multi-core simulator snoop each other's misses and
+   write upgrades over a bus. Invalid is TAG_INVALID, Modified is the only
+   state with Dirty set. The L2 is shared and not inclusive, it sees only
+   fills, writebacks and flushes. */
 
-    /* init cache */
-    if (SimpleCacheL1.init == 0) {
-        for (int i = 0; i < L1_SIZE / BLOCK_SIZE; i++) {
-            SimpleCacheL1.lines[i].Valid = 0;
+static uint32_t findWay(CacheLevel *Cache, uint32_t index, uint64_t Tag) {
+    if (Cache->init == 0)
+        return NO_WAY;
+    return lookupSet(&Cache->tags[index * Cache->ways], Cache->ways, Tag);
+}
+
+/* Drops a block from Cache without writing it anywhere */
+static void invalidateLine(CacheLevel *Cache, uint32_t index, uint32_t way) {
+    CacheLine *Line = &Cache->lines[index * Cache->ways + way];
+
+    Cache->tags[index * Cache->ways + way] = TAG_INVALID;
+    Cache->sets[index].Filled--;
+    Cache->stats.prefetchUseless += Line->Prefetched;
+    Line->Prefetched = 0;
+    Line->Dirty = 0;
+    Line->State = MESI_INVALID;
+}
+
+/* BusRd for a read miss, BusRdX for a write miss. A Modified peer supplies
+   the block into Block and returns 1; on a read it is also flushed to L2 and
+   both copies end up Shared. *State is the state the requester fills in. */
+static uint32_t snoopMiss(CacheLevel *Cache, uint32_t index, uint64_t Tag, uint32_t mode, uint8_t *Block, uint8_t *State) {
+    Simulator *Sim = Cache->sim;
+    uint32_t blockSize = Sim->config.blockSize;
+    uint32_t supplied = 0;
+
+    *State = MESI_EXCLUSIVE;
+    if (mode == MODE_READ)
+        Sim->coherence.busReads++;
+    else
+        Sim->coherence.busReadsX++;
+
+    for (uint32_t core = 0; core < Sim->numCores; core++) {
+        CacheLevel *Peer = &Sim->L1[core];
+        uint32_t way = Peer == Cache ? NO_WAY : findWay(Peer, index, Tag);
+        if (way == NO_WAY)
+            continue;
+
+        CacheLine *Line = &Peer->lines[index * Peer->ways + way];
+        uint8_t *PeerBlock = Peer->data != NULL ? &Peer->data[(index * Peer->ways + way) * blockSize] : NULL;
+
+        if (Line->Dirty) {                             // Modified, or Shared over an exclusive L2
+            if (PeerBlock != NULL)
+                memcpy(Block, PeerBlock, blockSize);
+            Sim->coherence.transfers++;
+            Sim->time += Sim->config.transferTime;
+            supplied = 1;
+            if (mode == MODE_READ) {
+                accessNextLevel(Peer, getMemAddressFromCacheInfo(Peer, Tag, index), PeerBlock, MODE_WRITE, blockSize);
+                Sim->coherence.flushes++;
+                Line->Dirty = 0;
+            }
+        }
+        if (mode == MODE_READ) {
+            Line->State = MESI_SHARED;
+            *State = MESI_SHARED;
+        } else {
+            invalidateLine(Peer, index, way);
+            Sim->coherence.invalidations++;
         }
-        SimpleCacheL1.init = 1;
     }
+    return supplied;
+}
 
-    CacheLine *Line = &SimpleCacheL1.lines[index];
+/* A write that bypasses a coherent L1 (no-write-allocate miss) still
+   invalidates every other copy, flushing a Modified one first so that the
+   rest of its block is not lost */
+static void snoopWrite(CacheLevel *Cache, uint32_t index, uint64_t Tag) {
+    Simulator *Sim = Cache->sim;
+    uint32_t blockSize = Sim->config.blockSize;
 
-    /* access Cachen */
-    if (!Line->Valid || Line->Tag != Tag) {             // if block not present - miss
-        accessL2Cache(address, TempBlock, MODE_READ);   // get new block from L2
+    Sim->coherence.busReadsX++;
+    for (uint32_t core = 0; core < Sim->numCores; core++) {
+        CacheLevel *Peer = &Sim->L1[core];
+        uint32_t way = Peer == Cache ? NO_WAY : findWay(Peer, index, Tag);
+        if (way == NO_WAY)
+            continue;
+        if (Peer->lines[index * Peer->ways + way].Dirty) {
+            uint8_t *PeerBlock = Peer->data != NULL ? &Peer->data[(index * Peer->ways + way) * blockSize] : NULL;
+            accessNextLevel(Peer, getMemAddressFromCacheInfo(Peer, Tag, index), PeerBlock, MODE_WRITE, blockSize);
+            Sim->coherence.flushes++;
+        }
+        invalidateLine(Peer, index, way);
+        Sim->coherence.invalidations++;
+    }
+}
+
+/* BusUpgr: a write hit on a Shared line invalidates every other copy.
+   Returns 1 if one of them was dirty (possible over an exclusive L2): the
+   writer then owns the dirty block. */
+static uint32_t snoopUpgrade(CacheLevel *Cache, uint32_t index, uint64_t Tag) {
+    Simulator *Sim = Cache->sim;
+    uint32_t dirty = 0;
 
-        if ((Line->Valid) && (Line->Dirty)) {           // line has dirty block
-            MemAddress = getMemAddressFromCacheInfo(Line->Tag, index, L1_SIZE);
-            accessL2Cache(MemAddress, &(L1Cache[CacheBlockIndex]), MODE_WRITE);  // then write back old block
+    Sim->coherence.upgrades++;
+    for (uint32_t core = 0; core < Sim->numCores; core++) {
+        CacheLevel *Peer = &Sim->L1[core];
+        uint32_t way = Peer == Cache ? NO_WAY : findWay(Peer, index, Tag);
+        if (way != NO_WAY) {
+            dirty |= Peer->lines[index * Peer->ways + way].Dirty;
+            invalidateLine(Peer, index, way);
+            Sim->coherence.invalidations++;
         }
+    }
+    return dirty;
+}
 
-        memcpy(&(L1Cache[CacheBlockIndex]), TempBlock, BLOCK_SIZE); // copy new block to L1
-        Line->Valid = 1;
-        Line->Tag = Tag;
-        Line->Dirty = 0;
+/*********************** Write buffer and victim cache *************************/
+
+static void evictBlock(CacheLevel *, uint64_t, uint8_t *, uint8_t);
+
+/* Writes a dirty block (or a written through word) to the next level,
+   through the write buffer when the level has one. Buffered writes drain
+   one after the other in the background; the access only waits when every
+   entry is still busy. */
+static void writeBack(CacheLevel *Cache, uint64_t address, uint8_t *Block, uint32_t size) {
+    Simulator *Sim = Cache->sim;
+    WriteBuffer *Buffer = &Cache->writeBuffer;
+
+    if (Buffer->entries == 0) {
+        accessNextLevel(Cache, address, Block, MODE_WRITE, size);
+        return;
     }
 
-    if (mode == MODE_READ) {    // read data from cache line
-        memcpy(data, &(L1Cache[CacheDataIndex]), WORD_SIZE);
-        time += L1_READ_TIME;
+    while (Buffer->count > 0 && Buffer->done[Buffer->head] <= Sim->time) {   // retire finished writes
+        Buffer->head = (Buffer->head + 1) % Buffer->entries;
+        Buffer->count--;
+    }
+    if (Buffer->count == Buffer->entries) {            // full, wait for the oldest
+        Cache->stats.bufferStalls++;
+        Sim->time = Buffer->done[Buffer->head];
+        Buffer->head = (Buffer->head + 1) % Buffer->entries;
+        Buffer->count--;
     }
 
-    if (mode == MODE_WRITE) { // write data to cache
-        memcpy(&(L1Cache[CacheDataIndex]), data, WORD_SIZE);
-        time += L1_WRITE_TIME;
-        Line->Dirty = 1;
+    uint64_t now = Sim->time;
+    accessNextLevel(Cache, address, Block, MODE_WRITE, size);
+    uint64_t cost = Sim->time - now;
+    Sim->time = now;
+
+    uint64_t start = now;
+    if (Buffer->count > 0) {
+        uint64_t last = Buffer->done[(Buffer->head + Buffer->count - 1) % Buffer->entries];
+        if (last > start)
+            start = last;
     }
+    Buffer->done[(Buffer->head + Buffer->count) % Buffer->entries] = start + cost;
+    Buffer->count++;
+    Cache->stats.bufferedWrites++;
 }
 
-/*********************** Cache L2 (2 way associative)*************************/
+/* Takes the block at address out of the victim cache into Block, returns
+   1 and its dirty bit in *Dirty if it was there */
+static uint32_t takeVictim(CacheLevel *Cache, uint64_t address, uint8_t *Block, uint8_t *Dirty) {
+    VictimCache *Victims = &Cache->victims;
+    uint32_t blockSize = Cache->sim->config.blockSize;
 
-void accessL2Cache(uint32_t address, uint8_t *data, uint32_t mode) {
+    for (uint32_t i = 0; i < Victims->count; i++) {
+        if (Victims->blocks[i] != address)
+            continue;
+        *Dirty = Victims->dirty[i];
+        if (Victims->data != NULL)
+            memcpy(Block, &Victims->data[(size_t)i * blockSize], blockSize);
+        /* close the gap, keeping the oldest first order */
+        uint32_t after = Victims->count - i - 1;
+        memmove(&Victims->blocks[i], &Victims->blocks[i + 1], after * sizeof(uint64_t));
+        memmove(&Victims->dirty[i], &Victims->dirty[i + 1], after);
+        if (Victims->data != NULL)
+            memmove(&Victims->data[(size_t)i * blockSize], &Victims->data[(size_t)(i + 1) * blockSize], (size_t)after * blockSize);
+        Victims->count--;
+        return 1;
+    }
+    return 0;
+}
 
-    uint32_t index, new_index, Tag, MemAddress, BlockOffset, CacheBlockIndex, CacheDataIndex;
-    uint8_t TempBlock[BLOCK_SIZE];
+static uint32_t hasVictim(const CacheLevel *Cache, uint64_t address) {
+    for (uint32_t i = 0; i < Cache->victims.count; i++)
+        if (Cache->victims.blocks[i] == address)
+            return 1;
+    return 0;
+}
 
-    index = getIndexAssociative(address, L2_SIZE);
-    Tag = getTagAssociative(address, L2_SIZE);
-    MemAddress = getMemAddress(address);
-    BlockOffset = getBlockOffset(address);
-    
+/* Keeps an evicted block, pushing the oldest one out (and back, if dirty) when full */
+static void putVictim(CacheLevel *Cache, uint64_t address, uint8_t *Block, uint8_t Dirty) {
+    VictimCache *Victims = &Cache->victims;
+    uint32_t blockSize = Cache->sim->config.blockSize;
 
-    /* init cache */
-    if (SimpleCacheL2.init == 0) {
-        for (int i = 0; i < L2_SIZE / BLOCK_SIZE; i++) {
-            SimpleCacheL2.lines[i].Valid = 0;
-            if ((i & 1) == 1) { /* if the last bit of the index is one*/
-                SimpleCacheL2.lines[i].Recent = 1;
-            } else {  SimpleCacheL2.lines[i].Recent = 0;}
-        }
-        SimpleCacheL2.init = 1;
-    }
-
-    
-    new_index = index << 1; /* Adding a zero at the end to reach the correct adress*/
-    CacheLine *Line;
-    CacheLine *Line0 = &SimpleCacheL2.lines[new_index];
-    CacheLine *Line1 = &SimpleCacheL2.lines[new_index + 1];
-
-    /*check which line will be replaced*/
-    if(!Line0->Recent) {
-        Line = Line0;
-        CacheBlockIndex = new_index * BLOCK_SIZE;
-        CacheDataIndex = CacheBlockIndex + BlockOffset;
+    if (Victims->count == Victims->entries) {
+        uint8_t Oldest[MAX_BLOCK_SIZE];
+        uint8_t OldestDirty;
+        uint64_t OldestAddress = Victims->blocks[0];
+        takeVictim(Cache, OldestAddress, Oldest, &OldestDirty);
+        evictBlock(Cache, OldestAddress, Victims->data != NULL ? Oldest : NULL, OldestDirty);
+    }
+    Victims->blocks[Victims->count] = address;
+    Victims->dirty[Victims->count] = Dirty;
+    if (Victims->data != NULL)
+        memcpy(&Victims->data[(size_t)Victims->count * blockSize], Block, blockSize);
+    Victims->count++;
+}
+
+/*********************** Event timing *************************/
+/* The event model replays each access on a clock per core that only waits
+   for what it has to. A demand miss holds an MSHR of every level it misses
+   in until its block arrives, and the core goes on issuing behind it; an
+   access to a block still on its way merges into that MSHR instead. A level
+   with every MSHR busy stalls the core until the next one frees. Latencies
+   are the ones the additive clock charged for the access, so both clocks
+   see the same hits, misses and costs. Cores are stepped in the order their
+   accesses are simulated. */
+
+#define EVENT_L2 MAX_CORES      // event level of the L2, an L1 uses its core
+
+static MshrFile *getEventMshrs(Simulator *Sim, uint32_t level) {
+    return level == EVENT_L2 ? &Sim->L2.mshrs : &Sim->L1[level].mshrs;
+}
+
+static void resetEventTiming(Simulator *Sim) {
+    Sim->cycles = 0;
+    memset(Sim->issue, 0, sizeof(Sim->issue));
+    Sim->events.count = 0;
+    for (uint32_t core = 0; core < Sim->numCores; core++) {
+        resetMshrFile(&Sim->L1[core].mshrs);
+        Sim->L1[core].missed = 0;
+    }
+    resetMshrFile(&Sim->L2.mshrs);
+    Sim->L2.missed = 0;
+}
+
+/* Remembers the first demand fill of Cache in an access, which started at start */
+static inline void recordMiss(CacheLevel *Cache, uint64_t address, uint64_t start) {
+    if (Cache->missed)
+        return;
+    Cache->missed = 1;
+    Cache->missBlock = address >> Cache->offsetBits;
+    Cache->missStart = start;
+    Cache->missCost = Cache->sim->time - start;
+}
+
+/* Frees the MSHRs whose fill is done by time */
+static void retireEvents(Simulator *Sim, uint64_t time) {
+    while (Sim->events.count > 0 && Sim->events.events[0].time <= time) {
+        TimingEvent Event = popEvent(&Sim->events);
+        releaseMshr(getEventMshrs(Sim, Event.level), Event.slot);
+    }
+}
+
+/* Moves *time on until Cache has a free MSHR */
+static void waitForMshr(Simulator *Sim, CacheLevel *Cache, uint64_t *time) {
+    if (Cache->mshrs.count == Cache->mshrs.entries)
+        Cache->stats.mshrStalls++;
+    while (Cache->mshrs.count == Cache->mshrs.entries) {   // each busy MSHR has an event queued
+        TimingEvent Event = popEvent(&Sim->events);
+        releaseMshr(getEventMshrs(Sim, Event.level), Event.slot);
+        if (Event.time > *time)
+            *time = Event.time;
+    }
+}
+
+/* The L2 side of an L1 fill going out at begin, returns when the block
+   arrives in the L1 */
+static uint64_t fetchFromL2(Simulator *Sim, CacheLevel *L1, uint64_t block, uint64_t begin) {
+    CacheLevel *L2 = &Sim->L2;
+    uint64_t arrive = begin + L1->missCost;
+    uint32_t slot = findMshr(&L2->mshrs, block);
+
+    if (slot != NO_MSHR) {                          // another core is fetching it already
+        L2->stats.mshrMerges++;
+        return arrive > L2->mshrs.done[slot] + L2->readTime ? arrive : L2->mshrs.done[slot] + L2->readTime;
+    }
+    if (!L2->missed || L2->missBlock != block)     // an L2 hit
+        return arrive;
+
+    uint64_t issued = begin + (L2->missStart - L1->missStart);
+    uint64_t at = issued;
+    waitForMshr(Sim, L2, &at);
+    slot = allocMshr(&L2->mshrs, block, at + L2->missCost);
+    pushEvent(&Sim->events, at + L2->missCost, EVENT_L2, slot);
+    return arrive + (at - issued);
+}
+
+/* Runs the access of core that moved the additive clock from start to
+   Sim->time on the event clock, returns its latency there */
+static uint64_t stepEventTiming(Simulator *Sim, uint32_t core, uint64_t address, uint64_t start) {
+    CacheLevel *L1 = &Sim->L1[core];
+    uint64_t block = address >> L1->offsetBits;
+    uint64_t latency = Sim->time - start;
+    uint64_t issued = Sim->issue[core];
+    uint64_t now = issued;
+    uint64_t complete, fetch = 0;
+    uint32_t slot;
+
+    retireEvents(Sim, now);
+    slot = findMshr(&L1->mshrs, block);
+    if (L1->missed && L1->missBlock == block) {
+        uint64_t lookup = L1->missStart - start;   // before the fill goes out
+        uint64_t arrive;
+        fetch = L1->missCost;
+        if (slot != NO_MSHR) {                      // refetched while still on its way
+            L1->stats.mshrMerges++;
+            arrive = now + lookup + fetch;
+            if (L1->mshrs.done[slot] > arrive)
+                arrive = L1->mshrs.done[slot];
+        } else {
+            waitForMshr(Sim, L1, &now);
+            arrive = fetchFromL2(Sim, L1, block, now + lookup);
+            slot = allocMshr(&L1->mshrs, block, arrive);
+            pushEvent(&Sim->events, arrive, core, slot);
+        }
+        complete = arrive + (latency - lookup - fetch);
     } else {
-        Line = Line1;
-        CacheBlockIndex = (new_index + 1) * BLOCK_SIZE;
-        CacheDataIndex = CacheBlockIndex + BlockOffset;
-    } 
+        complete = now + latency;
+        if (slot != NO_MSHR) {                      // a hit under the miss that brings the block
+            L1->stats.mshrMerges++;
+            if (L1->mshrs.done[slot] + latency > complete)
+                complete = L1->mshrs.done[slot] + latency;
+        }
+    }
+    Sim->issue[core] = now + latency - fetch;
+    if (complete > Sim->cycles)
+        Sim->cycles = complete;
+    L1->missed = 0;
+    Sim->L2.missed = 0;
+    return complete - issued;
+}
+
+/*********************** Inclusion *************************/
+
+static void classifyLevel(CacheLevel *Cache, uint64_t address, uint32_t miss) {
+    if (Cache->classifier != NULL && classifyAccess(Cache->classifier, address >> Cache->offsetBits, miss, &Cache->stats) != 0) {
+        fprintf(stderr, "classifyAccess: out of memory\n");
+        exit(-1);
+    }
+}
+
+/* The way a new block of set index goes to: a free one while there is
+   one (the set stays full afterwards), else the replacement victim */
+static uint32_t chooseWay(CacheLevel *Cache, uint32_t index) {
+    CacheSet *Set = &Cache->sets[index];
 
+    if (Set->Filled < Cache->ways) {
+        Set->Filled++;
+        return lookupSet(&Cache->tags[index * Cache->ways], Cache->ways, TAG_INVALID);
+    }
+    return chooseVictim(Cache, index);
+}
+
+/* An inclusive level dropping a block takes it out of every L1 as well.
+   A dirty L1 copy is newer than Block, so it replaces it and *Dirty is set. */
+static void backInvalidate(CacheLevel *Cache, uint64_t address, uint8_t *Block, uint8_t *Dirty) {
+    Simulator *Sim = Cache->sim;
+    uint32_t blockSize = Sim->config.blockSize;
+    uint8_t TempBlock[MAX_BLOCK_SIZE];
+    uint8_t VictimDirty;
 
-    /* access Cachen */
-    if ((!Line0->Valid || Line0->Tag != Tag)  &  (!Line1->Valid || Line1->Tag != Tag) ) {             // if block not present - miss
-        accessDRAM(MemAddress, TempBlock, MODE_READ);   // get new block from DRAM
+    for (uint32_t core = 0; core < Sim->numCores; core++) {
+        CacheLevel *Upper = &Sim->L1[core];
+        uint32_t index = getIndex(Upper, address);
+        uint32_t way = findWay(Upper, index, getTag(Upper, address));
 
-        if ((Line->Valid) && (Line->Dirty)) {           // line has dirty block
-            MemAddress = getMemAddressFromCacheInfoAssociative(Line->Tag, index, L2_SIZE);
-            accessDRAM(MemAddress, &(L2Cache[CacheBlockIndex]), MODE_WRITE);  // then write back old block
+        if (way != NO_WAY) {
+            if (Upper->lines[index * Upper->ways + way].Dirty) {
+                if (Block != NULL && Upper->data != NULL)
+                    memcpy(Block, &Upper->data[(index * Upper->ways + way) * blockSize], blockSize);
+                *Dirty = 1;
+            }
+            invalidateLine(Upper, index, way);
+            Cache->stats.backInvalidations++;
         }
+        if (Upper->victims.count && takeVictim(Upper, address, TempBlock, &VictimDirty)) {
+            if (VictimDirty) {
+                if (Block != NULL && Upper->victims.data != NULL)
+                    memcpy(Block, TempBlock, blockSize);
+                *Dirty = 1;
+            }
+            Cache->stats.backInvalidations++;
+        }
+    }
+}
 
-        memcpy(&(L2Cache[CacheBlockIndex]), TempBlock, BLOCK_SIZE); // copy new block to L2
-        Line->Valid = 1;
-        Line->Tag = Tag;
-        Line->Dirty = 0;
+/* Moves the block in way out of the level, into its victim cache if it
+   has one, else down to the next level */
+static void evictLine(CacheLevel *Cache, uint32_t index, uint32_t way) {
+    CacheLine *Line = &Cache->lines[index * Cache->ways + way];
+    uint8_t *Block = Cache->data != NULL ? &Cache->data[(index * Cache->ways + way) * Cache->sim->config.blockSize] : NULL;
+    uint64_t VictimAddress = getMemAddressFromCacheInfo(Cache, Cache->tags[index * Cache->ways + way], index);
+    uint8_t Dirty = Line->Dirty;
+
+    if (Cache->inclusiveAbove)
+        backInvalidate(Cache, VictimAddress, Block, &Dirty);
+    Cache->stats.evictions++;
+    Cache->stats.dirtyEvictions += Dirty;
+    Cache->stats.prefetchUseless += Line->Prefetched;
+
+    if (Cache->victims.entries)
+        putVictim(Cache, VictimAddress, Block, Dirty);
+    else
+        evictBlock(Cache, VictimAddress, Block, Dirty);
+}
+
+/* An L1 fill from an exclusive L2: a hit takes the block out of the L2,
+   keeping its dirty bit (returned); a miss reads it from below without
+   allocating it in the L2. */
+static uint8_t takeExclusive(CacheLevel *Cache, uint64_t address, uint8_t *Block) {
+    uint32_t blockSize = Cache->sim->config.blockSize;
+    uint8_t Dirty = 0;
+
+    if (Cache->init == 0)
+        resetLevel(Cache);
+    uint32_t index = getIndex(Cache, address);
+    uint32_t way = lookupSet(&Cache->tags[index * Cache->ways], Cache->ways, getTag(Cache, address));
+    classifyLevel(Cache, address, way == NO_WAY);
+
+    if (way != NO_WAY) {
+        Cache->stats.hits[MODE_READ]++;
+        CacheLine *Line = &Cache->lines[index * Cache->ways + way];
+        if (Cache->data != NULL)
+            memcpy(Block, &Cache->data[(index * Cache->ways + way) * blockSize], blockSize);
+        Dirty = Line->Dirty;
+        Cache->stats.prefetchHits += Line->Prefetched;
+        Line->Prefetched = 0;
+        invalidateLine(Cache, index, way);
+    } else {
+        uint64_t start = Cache->sim->time;
+        Cache->stats.misses[MODE_READ]++;
+        if (Cache->victims.entries && takeVictim(Cache, address, Block, &Dirty))
+            Cache->stats.victimHits++;
+        else
+            accessNextLevel(Cache, address, Block, MODE_READ, blockSize);
+        recordMiss(Cache, address, start);
+    }
+    Cache->sim->time += Cache->readTime;
+    return Dirty;
+}
+
+/* An L1 eviction into an exclusive L2, clean or dirty */
+static void insertExclusive(CacheLevel *Cache, uint64_t address, uint8_t *Block, uint8_t Dirty) {
+    uint32_t blockSize = Cache->sim->config.blockSize;
+
+    if (Cache->init == 0)
+        resetLevel(Cache);
+    uint32_t index = getIndex(Cache, address);
+    uint64_t Tag = getTag(Cache, address);
+    uint32_t way = lookupSet(&Cache->tags[index * Cache->ways], Cache->ways, Tag);
+    classifyLevel(Cache, address, way == NO_WAY);
+
+    if (way == NO_WAY) {
+        Cache->stats.misses[MODE_WRITE]++;
+        way = chooseWay(Cache, index);
+        if (Cache->tags[index * Cache->ways + way] != TAG_INVALID)
+            evictLine(Cache, index, way);
+        CacheLine *Line = &Cache->lines[index * Cache->ways + way];
+        Cache->tags[index * Cache->ways + way] = Tag;
+        Line->Dirty = Dirty;
+        Line->Prefetched = 0;
+        touchLine(Cache, index, way, 0);
+    } else {
+        Cache->stats.hits[MODE_WRITE]++;
+        Cache->lines[index * Cache->ways + way].Dirty |= Dirty;
+        touchLine(Cache, index, way, 1);
+    }
+    if (Block != NULL && Cache->data != NULL)
+        memcpy(&Cache->data[(index * Cache->ways + way) * blockSize], Block, blockSize);
+    Cache->sim->time += Cache->writeTime;
+}
+
+/* Passes an evicted block down: always into an exclusive L2, otherwise
+   only when it is dirty */
+static void evictBlock(CacheLevel *Cache, uint64_t address, uint8_t *Block, uint8_t Dirty) {
+    if (Dirty) {
+        writeBack(Cache, address, Block, Cache->sim->config.blockSize);
+    } else if (Cache->exclusiveBelow) {
+        Cache->stats.traffic[MODE_WRITE] += Cache->sim->config.blockSize;
+        insertExclusive(Cache->next, address, Block, 0);
+    }
+}
+
+/*********************** Caches (N way associative) *************************/
+
+/* Sends a block (or a word) to the level below */
+static void accessNextLevel(CacheLevel *Cache, uint64_t address, uint8_t *data, uint32_t mode, uint32_t size) {
+    Cache->stats.traffic[mode] += size;
+    if (Cache->exclusiveBelow && mode == MODE_WRITE && size == Cache->sim->config.blockSize)
+        insertExclusive(Cache->next, address, data, 1);
+    else if (Cache->next != NULL)
+        accessLevel(Cache->next, address, data, mode, size);
+    else
+        accessMemory(Cache->sim, address, data, mode, size);
+}
+
+/* Brings the block Tag of set index into Cache over a victim, writing the
+   victim back if it is dirty, and returns its way. A coherent L1 snoops its
+   peers first (mode decides BusRd or BusRdX). Does not touch the
+   replacement state or the hit/miss counters. */
+static uint32_t fillLine(CacheLevel *Cache, uint32_t index, uint64_t Tag, uint32_t mode) {
+
+    uint32_t way, supplied;
+    uint64_t MemAddress = getMemAddressFromCacheInfo(Cache, Tag, index);
+    uint8_t State = MESI_EXCLUSIVE;
+    uint8_t Dirty = 0;
+    uint32_t blockSize = Cache->sim->config.blockSize;
+    uint8_t TempBlock[MAX_BLOCK_SIZE];
+    uint64_t *Tags = &Cache->tags[index * Cache->ways];
+
+    way = chooseWay(Cache, index);
+    CacheLine *Line = &Cache->lines[index * Cache->ways + way];
+    uint32_t Valid = Tags[way] != TAG_INVALID;
+    uint8_t *Block = Cache->data != NULL ? &(Cache->data[(index * Cache->ways + way) * blockSize]) : NULL;
+
+    if (Cache->victims.entries && takeVictim(Cache, MemAddress, TempBlock, &Dirty)) {
+        Cache->stats.victimHits++;                   // swap back from the victim cache
+        Cache->sim->time += Cache->readTime;
+        supplied = 1;
+    } else {
+        supplied = Cache->coherent ? snoopMiss(Cache, index, Tag, mode, TempBlock, &State) : 0;
+        Dirty = supplied && mode == MODE_WRITE;     // a BusRdX takes over the dirty block unflushed
+    }
+    if (!supplied && Cache->exclusiveBelow) {
+        Cache->stats.traffic[MODE_READ] += blockSize;
+        Dirty = takeExclusive(Cache->next, MemAddress, TempBlock);
+    } else if (!supplied) {
+        accessNextLevel(Cache, MemAddress, TempBlock, MODE_READ, blockSize);    // get new block
+    }
+
+    /* an inclusive L2 may have just back-invalidated the victim, the way is then free */
+    if (Valid && Tags[way] == TAG_INVALID) {
+        Valid = 0;
+        Cache->sets[index].Filled++;
+    }
+    if (Valid)
+        evictLine(Cache, index, way);                // then write back old block
+
+    if (Block != NULL)
+        memcpy(Block, TempBlock, blockSize); // copy new block
+    Tags[way] = Tag;
+    Line->Dirty = Dirty;
+    Line->State = Dirty && State == MESI_EXCLUSIVE ? MESI_MODIFIED : State;
+    Line->Prefetched = 0;
+    return way;
+}
+
+/* Fetches the blocks the prefetcher predicts after a trigger at address.
+   Prefetches are off the critical path: the clock is put back afterwards,
+   and each block records when it would have arrived, the fills going out
+   one after the other. */
+static void issuePrefetches(CacheLevel *Cache, uint64_t address) {
+    Simulator *Sim = Cache->sim;
+    uint64_t Blocks[MAX_PREFETCH_DEGREE];
+    uint64_t now = Sim->time;
+    uint32_t count = predictPrefetches(&Cache->prefetch, address >> Cache->offsetBits, Blocks);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (Blocks[i] > (UINT64_MAX >> Cache->offsetBits))
+            continue;
+        uint64_t blockAddress = Blocks[i] << Cache->offsetBits;
+        if (Sim->config.dramSize != 0 && blockAddress >= Sim->config.dramSize)
+            continue;
+
+        uint32_t index = getIndex(Cache, blockAddress);
+        uint64_t Tag = getTag(Cache, blockAddress);
+        if (lookupSet(&Cache->tags[index * Cache->ways], Cache->ways, Tag) != NO_WAY)
+            continue;
+
+        uint32_t way = fillLine(Cache, index, Tag, MODE_READ);
+        Cache->lines[index * Cache->ways + way].Prefetched = 1;
+        Cache->ready[index * Cache->ways + way] = Sim->time;
+        Cache->stats.prefetches++;
+        touchLine(Cache, index, way, 0);
     }
+    Sim->time = now;
+}
+
+/* Reads or writes size bytes (a word from the CPU, or a whole block from
+   the level above) at address, filling the block from the next level on a
+   miss and writing back a dirty victim. Cache must be initialized. */
+static inline void accessReadyLevel(CacheLevel *Cache, uint64_t address, uint8_t *data, uint32_t mode, uint32_t size) {
+
+    uint32_t index, BlockOffset, CacheBlockIndex, CacheDataIndex, way, trigger = 0;
+    uint64_t Tag;
+    uint32_t blockSize = Cache->sim->config.blockSize;
+
+    index = getIndex(Cache, address);
+    Tag = getTag(Cache, address);
+    BlockOffset = getBlockOffset(Cache, address);
+
+    CacheLine *Lines = &Cache->lines[index * Cache->ways];
+
+    /* look for the block in the set */
+    way = lookupSet(&Cache->tags[index * Cache->ways], Cache->ways, Tag);
+
+    classifyLevel(Cache, address, way == NO_WAY);
+
+    if (way == NO_WAY && mode == MODE_WRITE && Cache->writeMiss == WRITE_NO_ALLOCATE &&
+        !(Cache->victims.count && hasVictim(Cache, getMemAddress(Cache, address)))) {
+        Cache->stats.misses[mode]++;                    // write around the level
+        Cache->stats.writeArounds++;
+        if (Cache->coherent)
+            snoopWrite(Cache, index, Tag);
+        Cache->sim->time += Cache->writeTime;
+        writeBack(Cache, address, data, size);
+        return;
+    }
+
+    if (way == NO_WAY) {                                // if block not present - miss
+        uint64_t start = Cache->sim->time;
+        Cache->stats.misses[mode]++;
+        way = fillLine(Cache, index, Tag, mode);
+        recordMiss(Cache, address, start);
+        touchLine(Cache, index, way, 0);
+        trigger = 1;
+    } else {
+        Cache->stats.hits[mode]++;
+        if (Lines[way].Prefetched) {                    // first use of a prefetched block
+            uint64_t ready = Cache->ready[index * Cache->ways + way];
+            Lines[way].Prefetched = 0;
+            Cache->stats.prefetchHits++;
+            if (Cache->sim->time < ready) {             // still on its way, wait for it
+                Cache->stats.prefetchLate++;
+                Cache->sim->time = ready;
+            }
+            trigger = 1;
+        }
+        if (Cache->coherent && mode == MODE_WRITE && Lines[way].State == MESI_SHARED && snoopUpgrade(Cache, index, Tag))
+            Lines[way].Dirty = 1;
+        touchLine(Cache, index, way, 1);
+    }
+    CacheBlockIndex = (index * Cache->ways + way) * blockSize;
+    CacheDataIndex = CacheBlockIndex + (size == WORD_SIZE ? BlockOffset : 0);
 
     if (mode == MODE_READ) {    // read data from cache line
-        memcpy(data, &(L2Cache[CacheDataIndex]), WORD_SIZE);
-        time += L2_READ_TIME;
-        
+        if (Cache->data != NULL)
+            memcpy(data, &(Cache->data[CacheDataIndex]), size);
+        Cache->sim->time += Cache->readTime;
     }
 
     if (mode == MODE_WRITE) { // write data to cache
-        memcpy(&(L2Cache[CacheDataIndex]), data, WORD_SIZE);
-        time += L2_WRITE_TIME;
+        if (Cache->data != NULL)
+            memcpy(&(Cache->data[CacheDataIndex]), data, size);
+        Cache->sim->time += Cache->writeTime;
+        if (Cache->writePolicy == WRITE_THROUGH) {      // the level below stays up to date
+            Cache->stats.writeThroughs++;
+            Lines[way].State = Lines[way].Dirty ? MESI_MODIFIED : MESI_EXCLUSIVE;
+            writeBack(Cache, address, data, size);
+        } else {
+            Lines[way].Dirty = 1;
+            Lines[way].State = MESI_MODIFIED;
+        }
+    }
+
+    if (trigger && Cache->prefetch.type != PREFETCH_NONE)
+        issuePrefetches(Cache, address);
+}
+
+void accessLevel(CacheLevel *Cache, uint64_t address, uint8_t *data, uint32_t mode, uint32_t size) {
+    /* init cache */
+    if (Cache->init == 0)
+        resetLevel(Cache);
+    accessReadyLevel(Cache, address, data, mode, size);
+}
+
+/* Like read()/write() in the original lab code, this works without
+   initCaches() first: the default simulator is set up on first use */
+void accessL1Cache(uint32_t address, uint8_t *data, uint32_t mode) {
+    configureDefault();
+    accessSimulatorCore(&DefaultSimulator, 0, address, data, mode);
+}
+
+/* Straight to the L2, which only exists with levels=2 */
+void accessL2Cache(uint32_t address, uint8_t *data, uint32_t mode) {
+    configureDefault();
+    if (DefaultSimulator.config.levels < 2) {
+        fprintf(stderr, "accessL2Cache: the simulator has no L2 (levels=%u)\n", DefaultSimulator.config.levels);
+        exit(-1);
+    }
+    accessLevel(&DefaultSimulator.L2, address, data, mode, WORD_SIZE);
+}
+
+/* Counters an access moves on its way down, to tell where it was served */
+typedef struct AccessMarks {
+    uint64_t L1Misses;
+    uint64_t L2Misses;
+    uint64_t writeBacks;
+} AccessMarks;
+
+static void markAccess(const Simulator *Sim, uint32_t core, AccessMarks *Marks) {
+    const LevelStats *L1 = &Sim->L1[core].stats;
+    const LevelStats *L2 = &Sim->L2.stats;
+
+    Marks->L1Misses = L1->misses[MODE_READ] + L1->misses[MODE_WRITE];
+    Marks->L2Misses = L2->misses[MODE_READ] + L2->misses[MODE_WRITE];
+    Marks->writeBacks = L1->dirtyEvictions + L2->dirtyEvictions;
+}
+
+static void recordAccessLatency(Simulator *Sim, uint32_t core, const AccessMarks *Before, uint32_t mode,
+                                uint64_t latency) {
+    AccessMarks After;
+    uint32_t latencyClass;
+
+    markAccess(Sim, core, &After);
+    if (After.L1Misses == Before->L1Misses)
+        latencyClass = LATENCY_L1_HIT;
+    else if (After.writeBacks != Before->writeBacks)
+        latencyClass = LATENCY_WRITE_BACK;
+    else if (Sim->config.levels > 1 && After.L2Misses == Before->L2Misses)
+        latencyClass = LATENCY_L2_HIT;
+    else
+        latencyClass = LATENCY_DRAM;
+    recordLatency(&Sim->latency->classes[latencyClass][mode], latency);
+}
+
+/* A word access from core, run on the event clock too when it is on */
+static inline void accessCore(Simulator *Sim, uint32_t core, uint64_t address, uint8_t *data, uint32_t mode) {
+    uint64_t start = Sim->time;
+    AccessMarks Marks;
+
+    if (Sim->latency != NULL)
+        markAccess(Sim, core, &Marks);
+    accessReadyLevel(&Sim->L1[core], address, data, mode, WORD_SIZE);
+    uint64_t latency = Sim->time - start;
+    if (Sim->config.timing == TIMING_EVENT)
+        latency = stepEventTiming(Sim, core, address, start);
+    if (Sim->latency != NULL)
+        recordAccessLatency(Sim, core, &Marks, mode, latency);
+}
+
+/* One word access from the CPU side of Sim */
+void accessSimulator(Simulator *Sim, uint64_t address, uint8_t *data, uint32_t mode) {
+    accessSimulatorCore(Sim, 0, address, data, mode);
+}
+
+/* The same from one core of a multi-core Sim, core < config.cores */
+void accessSimulatorCore(Simulator *Sim, uint32_t core, uint64_t address, uint8_t *data, uint32_t mode) {
+    if (Sim->L1[core].init == 0)
+        resetLevel(&Sim->L1[core]);
+    accessCore(Sim, core, address, data, mode);
+}
+
+/* count word accesses from one core in a row: addresses[i] with modes[i],
+   the word read into or written from data + i * WORD_SIZE. Every L1 is
+   initialized once up front, so the loop goes straight to the lookup. */
+void accessSimulatorBatch(Simulator *Sim, uint32_t core, const uint64_t *addresses, const uint8_t *modes,
+                          uint8_t *data, size_t count) {
+    for (uint32_t i = 0; i < Sim->numCores; i++)
+        if (Sim->L1[i].init == 0)
+            resetLevel(&Sim->L1[i]);
+    for (size_t i = 0; i < count; i++)
+        accessCore(Sim, core, addresses[i], data + i * WORD_SIZE, modes[i]);
+}
+
+/*********************** Functional warming *************************/
+
+/* What a detailed access leaves in the tags, dirty bits and replacement
+   state, without data, time or statistics: the fast-forward of sampled
+   simulation (see Sample.h). Blocks move between the levels in the same
+   order as in fillLine, so warming and detailed accesses can be mixed
+   freely. Covers what Sample.c accepts: one core, no prefetchers, victim
+   caches or exclusive L2, tag only. */
+static void warmLevel(CacheLevel *Cache, uint64_t address, uint32_t mode) {
+    if (Cache->init == 0)
+        resetLevel(Cache);
+
+    uint32_t index = getIndex(Cache, address);
+    uint64_t Tag = getTag(Cache, address);
+    uint64_t *Tags = &Cache->tags[index * Cache->ways];
+    uint32_t way = lookupSet(Tags, Cache->ways, Tag);
+
+    if (way == NO_WAY && mode == MODE_WRITE && Cache->writeMiss == WRITE_NO_ALLOCATE) {
+        if (Cache->next != NULL)
+            warmLevel(Cache->next, address, MODE_WRITE);
+        return;
+    }
+    if (way == NO_WAY) {
+        way = chooseWay(Cache, index);
+        CacheLine *Line = &Cache->lines[index * Cache->ways + way];
+        uint32_t Valid = Tags[way] != TAG_INVALID;
+
+        if (Cache->next != NULL)
+            warmLevel(Cache->next, getMemAddress(Cache, address), MODE_READ);
+        if (Valid && Tags[way] == TAG_INVALID) {        // back-invalidated by an inclusive L2
+            Valid = 0;
+            Cache->sets[index].Filled++;
+        }
+        if (Valid) {
+            uint64_t VictimAddress = getMemAddressFromCacheInfo(Cache, Tags[way], index);
+            uint8_t Dirty = Line->Dirty;
+            if (Cache->inclusiveAbove) {
+                uint64_t counted = Cache->stats.backInvalidations;
+                backInvalidate(Cache, VictimAddress, NULL, &Dirty);
+                Cache->stats.backInvalidations = counted;
+            }
+            if (Dirty && Cache->next != NULL)
+                warmLevel(Cache->next, VictimAddress, MODE_WRITE);
+        }
+        Tags[way] = Tag;
+        Line->Dirty = 0;
+        Line->State = MESI_EXCLUSIVE;
+        Line->Prefetched = 0;
+        touchLine(Cache, index, way, 0);
+    } else {
+        touchLine(Cache, index, way, 1);
+    }
+
+    CacheLine *Line = &Cache->lines[index * Cache->ways + way];
+    if (mode == MODE_WRITE && Cache->writePolicy == WRITE_THROUGH) {
+        Line->State = Line->Dirty ? MESI_MODIFIED : MESI_EXCLUSIVE;
+        if (Cache->next != NULL)
+            warmLevel(Cache->next, address, MODE_WRITE);
+    } else if (mode == MODE_WRITE) {
         Line->Dirty = 1;
+        Line->State = MESI_MODIFIED;
+    }
+}
+
+/* One word access from core 0 of Sim, warming only */
+void warmSimulator(Simulator *Sim, uint64_t address, uint32_t mode) {
+    warmLevel(&Sim->L1[0], address, mode);
+}
+
+uint64_t getSimulatorTime(const Simulator *Sim) { return Sim->time; }
+
+uint64_t getSimulatorCycles(const Simulator *Sim) { return Sim->cycles; }
 
+/*********************** Statistics *************************/
+
+void resetSimulatorStats(Simulator *Sim) {
+    for (uint32_t core = 0; core < Sim->numCores; core++) {
+        memset(&Sim->L1[core].stats, 0, sizeof(LevelStats));
+        if (Sim->L1[core].classifier != NULL)
+            resetClassifier(Sim->L1[core].classifier);
+    }
+    memset(&Sim->L2.stats, 0, sizeof(LevelStats));
+    memset(&Sim->memoryStats, 0, sizeof(DRAMStats));
+    memset(&Sim->coherence, 0, sizeof(CoherenceStats));
+    if (Sim->latency != NULL)
+        memset(Sim->latency, 0, sizeof(LatencyStats));
+    Sim->statsTime = Sim->time;
+    Sim->statsCycles = Sim->cycles;
+    if (Sim->L2.classifier != NULL)
+        resetClassifier(Sim->L2.classifier);
+}
+
+static const char *CoreNames[MAX_CORES] = {
+    "L1_0", "L1_1", "L1_2", "L1_3", "L1_4", "L1_5", "L1_6", "L1_7",
+    "L1_8", "L1_9", "L1_10", "L1_11", "L1_12", "L1_13", "L1_14", "L1_15"
+};
+
+StatsReport getSimulatorStats(const Simulator *Sim) {
+    StatsReport Report;
+    uint32_t cores = Sim->numCores ? Sim->numCores : 1;
+
+    memset(&Report, 0, sizeof(Report));
+    Report.time = Sim->time - Sim->statsTime;
+    Report.cycles = Sim->cycles - Sim->statsCycles;
+    Report.cores = cores;
+    for (uint32_t core = 0; core < cores; core++) {
+        Report.names[core] = cores == 1 ? "L1" : CoreNames[core];
+        Report.levels[core] = &Sim->L1[core].stats;
     }
+    if (Sim->config.levels > 1) {
+        Report.names[cores] = "L2";
+        Report.levels[cores] = &Sim->L2.stats;
+    }
+    Report.dram = &Sim->memoryStats;
+    Report.coherence = cores > 1 ? &Sim->coherence : NULL;
+    Report.latency = Sim->latency;
+    return Report;
+}
+
+void resetStats() { resetSimulatorStats(&DefaultSimulator); }
+
+StatsReport getStatsReport() { return getSimulatorStats(&DefaultSimulator); }
+
+/* STATS_JSON, or STATS_CSV as a header line plus one row */
+void printSimulatorStats(FILE *out, const Simulator *Sim, uint32_t format) {
+    StatsReport Report = getSimulatorStats(Sim);
 
-    /* Update the recent bits */
-    Line->Recent = 1;
-    if (Line->Tag == Line0->Tag) {
-        Line1->Recent = 0;  
+    if (format == STATS_CSV) {
+        printStatsCSVHeader(out, &Report);
+        printStatsCSV(out, &Report);
     } else {
-        Line0->Recent = 0;
-    }  
-}   
+        printStatsJSON(out, &Report);
+    }
+}
+
+void printStats(FILE *out, uint32_t format) { printSimulatorStats(out, &DefaultSimulator, format); }
 
 void read(uint32_t address, uint8_t *data) {
+    if (Hook != NULL)
+        Hook(HookContext, address, MODE_READ);
     accessL1Cache(address, data, MODE_READ);
 }
 
 void write(uint32_t address, uint8_t *data) {
+    if (Hook != NULL)
+        Hook(HookContext, address, MODE_WRITE);
     accessL1Cache(address, data, MODE_WRITE);
 }
+
+/* hook(context, address, mode) runs before every read() and write(), and
+   every word of accessBatch, NULL to stop */
+void setAccessHook(AccessHook hook, void *context) {
+    Hook = hook;
+    HookContext = context;
+}
+
+/* read()/write() for count words at once, see accessSimulatorBatch */
+void accessBatch(const uint32_t *addresses, const uint8_t *modes, uint8_t *data, size_t count) {
+    uint64_t Addresses[1024];
+    const size_t chunk = sizeof(Addresses) / sizeof(Addresses[0]);
+
+    configureDefault();
+    for (size_t done = 0; done < count; done += chunk) {
+        size_t length = count - done < chunk ? count - done : chunk;
+        for (size_t i = 0; i < length; i++) {
+            Addresses[i] = addresses[done + i];
+            if (Hook != NULL)
+                Hook(HookContext, addresses[done + i], modes[done + i]);
+        }
+        accessSimulatorBatch(&DefaultSimulator, 0, Addresses, modes + done, data + done * WORD_SIZE, length);
+    }
+}
@@ -5,67 +5,316 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
-#include <math.h>
+#include <stddef.h>
 #include "Cache.h"
+#include "Stats.h"
+#include "Memory.h"
+#include "Prefetch.h"
+#include "Timing.h"
+#include "Arena.h"
+
+#define MAX_BLOCK_SIZE 4096     // largest block size accepted by configureCaches
+#define MAX_CORES 16            // private L1s sharing the L2
+#define MAX_LEVELS 2            // the L1s and a shared L2
+#define MAX_BUFFER_ENTRIES 64   // largest write buffer or victim cache
+
+/* Replacement policies, selected per level */
+#define REPLACEMENT_LRU 0       // exact LRU, O(1) list per set
+#define REPLACEMENT_PLRU 1      // tree pseudo-LRU
+#define REPLACEMENT_FIFO 2
+#define REPLACEMENT_RANDOM 3
+#define REPLACEMENT_SRRIP 4     // static re-reference interval prediction, 2 bit
+#define NUM_REPLACEMENTS 5
+
+/* Write policies, per level. Write-through with no-write-allocate is
+   usually called write-around. */
+#define WRITE_BACK 0            // write hits stay in the level until eviction
+#define WRITE_THROUGH 1         // write hits also go to the next level, lines stay clean
+#define NUM_WRITE_POLICIES 2
+#define WRITE_ALLOCATE 0        // a write miss fills the block first
+#define WRITE_NO_ALLOCATE 1     // a write miss goes straight to the next level
+#define NUM_WRITE_MISS_POLICIES 2
+
+/* What the L2 holds relative to the L1s */
+#define INCLUSION_NINE 0        // non-inclusive non-exclusive: fills go through, evictions are independent
+#define INCLUSION_INCLUSIVE 1   // every L1 block is in the L2, L2 evictions back-invalidate the L1s
+#define INCLUSION_EXCLUSIVE 2   // L2 is a victim cache: L1 fills take blocks out, L1 evictions put them in
+#define NUM_INCLUSIONS 3
+
+/* Timing models. The additive clock charges every access in full, one
+   after the other; the event model also overlaps misses up to the MSHRs
+   of each level and reports the cycles that takes. */
+#define TIMING_ADDITIVE 0
+#define TIMING_EVENT 1
+#define NUM_TIMINGS 2
+
+/*********************** Configuration *************************/
+
+typedef struct LevelConfig {
+  uint32_t size;        // in bytes
+  uint32_t ways;        // power of two, 0 for fully associative
+  uint32_t replacement;
+  uint32_t readTime;
+  uint32_t writeTime;
+  uint32_t prefetcher;      // PREFETCH_*
+  uint32_t prefetchDegree;
+  uint32_t writeBuffer;     // write back buffer entries, 0 for none
+  uint32_t victimEntries;   // victim cache blocks, 0 for none
+  uint32_t writePolicy;     // WRITE_BACK or WRITE_THROUGH
+  uint32_t writeMiss;       // WRITE_ALLOCATE or WRITE_NO_ALLOCATE
+  uint32_t mshrs;           // outstanding misses, event timing only
+} LevelConfig;
+
+typedef struct CacheConfig {
+  uint32_t blockSize;   // in bytes
+  uint32_t dramSize;    // in bytes, 0 for the whole 64 bit address space
+  uint32_t dramReadTime;
+  uint32_t dramWriteTime;
+  uint32_t classifyMisses;  // split misses into compulsory/capacity/conflict
+  uint32_t latencyHistograms; // record every access's latency, see LatencyStats
+  uint32_t tagOnly;         // timing only: no DRAM or data arrays, read() leaves data untouched
+  uint32_t cores;           // private L1s, kept coherent with MESI when more than one
+  uint32_t levels;          // 1 puts the L1s straight over DRAM, 2 adds the L2
+  uint32_t transferTime;    // cache to cache transfer of a Modified block
+  uint32_t inclusion;       // INCLUSION_*
+  uint32_t timing;          // TIMING_*
+  uint32_t pages;           // ARENA_PAGES_*, what backs the cache arrays and DRAM
+  LevelConfig L1;
+  LevelConfig L2;
+} CacheConfig;
+
+CacheConfig getDefaultConfig();
+
+int setConfigValue(CacheConfig *, const char *, uint32_t);
+
+int getReplacementByName(const char *);
+
+const char *getReplacementName(uint32_t);
+
+int getWritePolicyByName(const char *);
+
+const char *getWritePolicyName(uint32_t);
+
+int getWriteMissByName(const char *);
+
+const char *getWriteMissName(uint32_t);
+
+int getInclusionByName(const char *);
+
+const char *getInclusionName(uint32_t);
+
+int getTimingByName(const char *);
+
+const char *getTimingName(uint32_t);
+
+int getPagesByName(const char *);
+
+const char *getPagesName(uint32_t);
+
+int getPrefetcherByName(const char *);
+
+const char *getPrefetcherName(uint32_t);
+
+int setConfigOption(CacheConfig *, const char *, const char *);
+
+int parseConfigOption(CacheConfig *, const char *);
+
+int parseConfigLine(CacheConfig *, char *);
+
+int loadConfigFile(CacheConfig *, const char *);
+
+void printConfig(FILE *, const CacheConfig *);
+
+void printConfigCSVHeader(FILE *);
+
+void printConfigCSV(FILE *, const CacheConfig *);
+
+/*********************** Time Manipulation *************************/
 
 void resetTime();
 
 uint32_t getTime();
 
+uint32_t getCycles();
+
 /****************  RAM memory (byte addressable) ***************/
 void accessDRAM(uint32_t, uint8_t *, uint32_t);
 
 /*********************** Cache *************************/
 
-void initCaches();
+/* MESI states, only tracked in the L1s of a multi-core simulator */
+#define MESI_INVALID 0
+#define MESI_SHARED 1
+#define MESI_EXCLUSIVE 2
+#define MESI_MODIFIED 3
 
-uint32_t createBitMask(uint32_t);
+#define TAG_INVALID UINT64_MAX  // tag of an empty way, never a real tag (blocks are at least a word)
 
-uint32_t getNumIndexBits(uint32_t);
+/* Tags and valid bits live apart in CacheLevel.tags, one vector per set */
+typedef struct CacheLine {
+  uint8_t Dirty;
+  uint8_t RRPV;     /* SRRIP re-reference prediction value */
+  uint8_t State;    /* MESI_* */
+  uint8_t Prefetched; /* brought in by the prefetcher and not used yet */
+  uint32_t Prev;    /* LRU list inside the set, as way numbers */
+  uint32_t Next;
+} CacheLine;
+
+typedef struct CacheSet {
+  uint32_t Head;    /* most recently used way */
+  uint32_t Tail;    /* least recently used way */
+  uint32_t Fifo;    /* next way to replace under FIFO */
+  uint32_t Filled;  /* valid ways, a victim is only chosen once all are */
+} CacheSet;
+
+/* Dirty blocks on their way to the next level. The write itself is done
+   at once, only its time is taken off the critical path: each entry holds
+   the time its write completes, and a full buffer stalls until the oldest does. */
+typedef struct WriteBuffer {
+  uint32_t entries;
+  uint32_t head;
+  uint32_t count;
+  uint64_t *done;
+} WriteBuffer;
+
+/* Small fully associative cache of the blocks a level evicted, oldest first */
+typedef struct VictimCache {
+  uint32_t entries;
+  uint32_t count;
+  uint64_t *blocks;         // block addresses
+  uint8_t *dirty;
+  uint8_t *data;            // entries blocks, NULL in tag only mode
+} VictimCache;
+
+/* Geometry is fixed by configureCaches; the shifts and masks are
+   precomputed there so decoding an address is a few integer ops.
+   Way w of set s is tags[s * ways + w] and lines[s * ways + w], its block
+   data[(s * ways + w) * blockSize]. */
+typedef struct CacheLevel {
+  uint32_t init;
+  uint32_t size;
+  uint32_t ways;
+  uint32_t replacement;
+  uint32_t numLines;
+  uint32_t numSets;
+  uint32_t offsetBits;
+  uint32_t tagShift;      // offsetBits + index bits
+  uint32_t offsetMask;
+  uint32_t indexMask;
+  uint32_t readTime;
+  uint32_t writeTime;
+  uint32_t writePolicy;
+  uint32_t writeMiss;
+  uint64_t *tags;         // TAG_INVALID when the way is empty
+  CacheLine *lines;
+  CacheSet *sets;
+  uint64_t *plru;         // tree bits, plruWords per set, node n is bit n
+  uint32_t plruWords;
+  uint32_t random;        // xorshift state
+  uint32_t core;          // which core an L1 belongs to
+  uint32_t coherent;      // snoop the other L1s
+  uint32_t exclusiveBelow;  // an L1 over an exclusive L2
+  uint32_t inclusiveAbove;  // an inclusive L2, back-invalidates the L1s
+  uint8_t *data;            // NULL in tag only mode
+  struct CacheLevel *next;  // NULL when the next level is DRAM
+  struct Simulator *sim;    // owner, for the clock and DRAM
+  LevelStats stats;
+  MissClassifier *classifier; // NULL unless classifyMisses is set
+  Prefetcher prefetch;
+  uint64_t *ready;          // per line, when a prefetched block arrives; NULL without a prefetcher
+  WriteBuffer writeBuffer;
+  VictimCache victims;
+  MshrFile mshrs;           // event timing only
+  uint32_t missed;          // the miss below was recorded since the last event timing step
+  uint64_t missBlock;       // first demand fill of the access: block number,
+  uint64_t missStart;       // additive time it started at
+  uint64_t missCost;        // and how long it took
+} CacheLevel;
+
+/* One complete hierarchy: independent instances can run side by side */
+typedef struct Simulator {
+  uint32_t configured;
+  CacheConfig config;
+  uint64_t time;
+  uint64_t cycles;          // event timing: when the last access completes
+  uint64_t statsTime;       // time and cycles when the statistics were last cleared,
+  uint64_t statsCycles;     // the report counts from there
+  uint64_t issue[MAX_CORES];  // event timing: when each core issues its next access
+  EventQueue events;        // MSHR releases
+  Arena arena;              // every cache array, sized at setup
+  uint8_t *snapshot;        // restored from (see Checkpoint.h), arrays may point into it
+  uint64_t snapshotSize;
+  SparseMemory DRAM;        // unused in tag only mode
+  DRAMStats memoryStats;
+  CoherenceStats coherence;
+  LatencyStats *latency;    // in the arena, NULL unless latencyHistograms is set
+  uint32_t numCores;
+  CacheLevel L1[MAX_CORES]; // private, numCores of them
+  CacheLevel L2;            // shared
+} Simulator;
+
+Simulator *createSimulator(const CacheConfig *);
+
+void freeSimulator(Simulator *);
+
+int setupSimulator(Simulator *, const CacheConfig *);
+
+void cleanupSimulator(Simulator *);
+
+void resetSimulator(Simulator *);
+
+void accessSimulator(Simulator *, uint64_t, uint8_t *, uint32_t);
+
+void accessSimulatorCore(Simulator *, uint32_t, uint64_t, uint8_t *, uint32_t);
+
+void accessSimulatorBatch(Simulator *, uint32_t, const uint64_t *, const uint8_t *, uint8_t *, size_t);
 
-uint32_t getNumBlockOffsetBits();
+void warmSimulator(Simulator *, uint64_t, uint32_t);
 
-uint32_t getTag(uint32_t, uint32_t);
+uint64_t getSimulatorTime(const Simulator *);
 
-uint32_t getIndex(uint32_t, uint32_t);
+uint64_t getSimulatorCycles(const Simulator *);
 
-uint32_t getNumIndexBitsAssociative(uint32_t);
+void resetSimulatorStats(Simulator *);
 
-uint32_t getTagAssociative(uint32_t, uint32_t);
+StatsReport getSimulatorStats(const Simulator *);
 
-uint32_t getIndexAssociative(uint32_t, uint32_t);
+void printSimulatorStats(FILE *, const Simulator *, uint32_t);
 
-uint32_t getBlockOffset(uint32_t);
+/* The functions below work on a default instance */
+int configureCaches(const CacheConfig *);
 
-uint32_t getMemAddress(uint32_t);
+void initCaches();
+
+void freeCaches();
+
+uint32_t createBitMask(uint32_t);
+
+uint32_t getNumBits(uint32_t);
 
-uint32_t getMemAddressFromCacheInfo(uint32_t, uint32_t, uint32_t);
+uint64_t getTag(const CacheLevel *, uint64_t);
 
-uint32_t getMemAddressFromCacheInfoAssociative(uint32_t, uint32_t, uint32_t);
+uint32_t getIndex(const CacheLevel *, uint64_t);
 
+uint32_t getBlockOffset(const CacheLevel *, uint64_t);
+
+uint64_t getMemAddress(const CacheLevel *, uint64_t);
+
+uint64_t getMemAddressFromCacheInfo(const CacheLevel *, uint64_t, uint32_t);
+
+void accessLevel(CacheLevel *, uint64_t, uint8_t *, uint32_t, uint32_t);
 
 void accessL1Cache(uint32_t, uint8_t *, uint32_t);
 
 void accessL2Cache(uint32_t, uint8_t *, uint32_t);
 
+/*********************** Statistics *************************/
 
+void resetStats();
 
-typedef struct CacheLine {
-  uint8_t Valid;
-  uint8_t Dirty;
-  uint32_t Tag;
-  uint8_t Recent;  /*Whichever line has this bit as 1 is the one who was acessed most recently*/
-} CacheLine;
-
-typedef struct CacheL1 {
-  uint32_t init;
-  CacheLine lines[L1_SIZE / BLOCK_SIZE];
-} CacheL1;
+StatsReport getStatsReport();
 
-typedef struct CacheL2 {
-  uint32_t init;
-  CacheLine lines[L2_SIZE / BLOCK_SIZE];
-} CacheL2;
+void printStats(FILE *, uint32_t);
 
 /*********************** Interfaces *************************/
 
@@ -73,4 +322,10 @@ void read(uint32_t, uint8_t *);
 
 void write(uint32_t, uint8_t *);
 
+typedef void (*AccessHook)(void *, uint32_t, uint32_t);
+
+void setAccessHook(AccessHook, void *);
+
+void accessBatch(const uint32_t *, const uint8_t *, uint8_t *, size_t);
+
 #endif
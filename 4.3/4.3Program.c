@@ -1,6 +1,20 @@
 #include "4.3Cache.h"
+#include "../trace/Trace.h"
 
-int main() {
+/* With a file argument, every access is also captured there as a packed trace */
+static void captureAccess(void *writer, uint32_t address, uint32_t mode) {
+  appendTraceRecord(writer, address, mode == MODE_READ ? TRACE_MODE_READ : TRACE_MODE_WRITE, WORD_SIZE, 0);
+}
+
+int main(int argc, char **argv) {
+
+  TraceWriter writer;
+
+  if (argc > 1) {
+    if (createPackedTrace(&writer, argv[1]) != 0)
+      return -1;
+    setAccessHook(captureAccess, &writer);
+  }
 
   // set seed for random number generator
   srand(0);
@@ -46,6 +60,10 @@ int main() {
       printf("Write; Address %d; Value %d; Time %d\n", address, address, clock1);
     }
   }
-  
+
+  if (argc > 1 && closeTraceWriter(&writer) != 0) {
+    fprintf(stderr, "%s: write failed\n", argv[1]);
+    return -1;
+  }
   return 0;
 }
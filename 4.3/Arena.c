@@ -0,0 +1,69 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "Arena.h"
+
+void initArena(Arena *Pool, uint32_t pages) {
+    Pool->pages = pages;
+    Pool->chunks = NULL;
+    Pool->used = 0;
+    Pool->mapped = 0;
+}
+
+/* Maps at least size bytes, rounded up to whole huge pages so that THP can
+   back all of it */
+static ArenaChunk *mapChunk(Arena *Pool, size_t size) {
+    ArenaChunk *Chunk = malloc(sizeof(ArenaChunk));   // kept off the mapping, which stays untouched
+    void *base = MAP_FAILED;
+
+    if (Chunk == NULL)
+        return NULL;
+    size = size < ARENA_CHUNK ? ARENA_CHUNK : (size + ARENA_HUGE_PAGE - 1) & ~(size_t)(ARENA_HUGE_PAGE - 1);
+#ifdef MAP_HUGETLB
+    if (Pool->pages == ARENA_PAGES_HUGETLB)
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (base == MAP_FAILED) {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            free(Chunk);
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        if (Pool->pages != ARENA_PAGES_NORMAL)
+            madvise(base, size, MADV_HUGEPAGE);
+#endif
+    }
+    Chunk->base = base;
+    Chunk->size = size;
+    Chunk->next = Pool->chunks;
+    Pool->chunks = Chunk;
+    Pool->used = 0;
+    Pool->mapped += size;
+    return Chunk;
+}
+
+/* size zeroed bytes aligned to ARENA_ALIGNMENT, NULL when out of memory.
+   The rest of a chunk too small for a request is left unused. */
+void *allocArena(Arena *Pool, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (size == 0)
+        size = ARENA_ALIGNMENT;
+    if ((Pool->chunks == NULL || Pool->chunks->size - Pool->used < size) && mapChunk(Pool, size) == NULL)
+        return NULL;
+
+    void *memory = Pool->chunks->base + Pool->used;
+    Pool->used += size;
+    return memory;
+}
+
+void freeArena(Arena *Pool) {
+    while (Pool->chunks != NULL) {
+        ArenaChunk *Chunk = Pool->chunks;
+        Pool->chunks = Chunk->next;
+        munmap(Chunk->base, Chunk->size);
+        free(Chunk);
+    }
+    Pool->used = 0;
+    Pool->mapped = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bump allocator over anonymous mappings. A simulator takes its arrays
+   from a few large regions instead of many heap blocks, so they can sit
+   on huge pages, and frees them all at once. Fresh mappings read as zeros
+   and are faulted in by the first thread to touch them, which on a NUMA
+   host places them on that thread's node. */
+
+#define ARENA_PAGES_NORMAL 0    // 4 KiB pages
+#define ARENA_PAGES_THP 1       // madvise(MADV_HUGEPAGE), transparent huge pages
+#define ARENA_PAGES_HUGETLB 2   // MAP_HUGETLB, THP when none are reserved
+#define NUM_ARENA_PAGES 3
+
+#define ARENA_HUGE_PAGE (2 << 20)
+#define ARENA_CHUNK ARENA_HUGE_PAGE     // smallest mapping
+#define ARENA_ALIGNMENT 64
+
+typedef struct ArenaChunk {
+  struct ArenaChunk *next;
+  uint8_t *base;
+  size_t size;
+} ArenaChunk;
+
+typedef struct Arena {
+  uint32_t pages;         // ARENA_PAGES_*
+  ArenaChunk *chunks;     // the newest one is allocated from
+  size_t used;            // bytes of the newest chunk handed out
+  uint64_t mapped;        // bytes mapped over every chunk
+} Arena;
+
+void initArena(Arena *, uint32_t);
+
+void *allocArena(Arena *, size_t);
+
+void freeArena(Arena *);
+
+#endif
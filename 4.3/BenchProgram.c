@@ -0,0 +1,376 @@
+#include <time.h>
+#include <math.h>
+#include "4.3Cache.h"
+
+/*
+ * Runs named synthetic kernels through a simulator instance and reports,
+ * per kernel, the simulated metrics next to the host side throughput, so a
+ * change that slows the simulator down shows up as well as one that changes
+ * its results:
+ *   Bench [-c config] [-s name=value]... [-n accesses] [-f bytes] [-r repetitions]
+ *         [-x csv] [kernel...]
+ *
+ * Every kernel generates its accesses up front from a fixed seed, so runs are
+ * reproducible; only the simulation itself is timed, as the best of the
+ * repetitions, each starting from empty caches. The footprint defaults to the
+ * DRAM size (16 MiB with dram_size=0). Kernels:
+ *   sequential   read every word in order, over and over
+ *   strided      read every STRIDE_BLOCKS blocks, one word further each pass
+ *   random       uniform random words, one in four written
+ *   zipf         words of a Zipfian hot set of blocks, one in four written
+ *   chase        follow a random cycle through every block (pointer chasing)
+ *   matmul       C += A * B on square matrices, TILE x TILE tiles
+ *   stencil      5 point Jacobi sweeps between two square grids
+ */
+
+#define ACCESSES (1 << 22)
+#define REPETITIONS 3
+#define FOOTPRINT (1 << 24)     // when dram_size=0
+#define SEED 0x2545F4914F6CDD1DULL
+#define STRIDE_BLOCKS 4
+#define ZIPF_THETA 0.99
+#define TILE 16
+
+/* Where a kernel writes its accesses, and what it may touch */
+typedef struct Emitter {
+  uint64_t *addresses;
+  uint8_t *modes;
+  size_t count;
+  size_t length;
+  uint64_t footprint;
+  uint32_t blockSize;
+  uint64_t random;        // xorshift64* state
+} Emitter;
+
+typedef struct Kernel {
+  const char *name;
+  void (*generate)(Emitter *);
+} Kernel;
+
+/* Adds one access, returns 1 once the emitter is full */
+static int emit(Emitter *out, uint64_t address, uint8_t mode) {
+  out->addresses[out->length] = address;
+  out->modes[out->length] = mode;
+  return ++out->length == out->count;
+}
+
+static uint64_t nextRandom(Emitter *out) {
+  out->random ^= out->random >> 12;
+  out->random ^= out->random << 25;
+  out->random ^= out->random >> 27;
+  return out->random * 0x2545F4914F6CDD1DULL;
+}
+
+static uint64_t randomWord(Emitter *out, uint64_t bytes) {
+  return nextRandom(out) % (bytes / WORD_SIZE) * WORD_SIZE;
+}
+
+static uint8_t randomMode(Emitter *out) {
+  return nextRandom(out) % 4 == 0 ? MODE_WRITE : MODE_READ;
+}
+
+/* Largest power of two n with matrices * n * n words in the footprint */
+static uint64_t getMatrixSide(uint64_t footprint, uint32_t matrices) {
+  uint64_t side = 1;
+  while (matrices * (2 * side) * (2 * side) * WORD_SIZE <= footprint)
+    side *= 2;
+  return side;
+}
+
+/*********************** Kernels *************************/
+
+static void generateSequential(Emitter *out) {
+  for (uint64_t i = 0; ; i++)
+    if (emit(out, i * WORD_SIZE % out->footprint, MODE_READ))
+      return;
+}
+
+static void generateStrided(Emitter *out) {
+  uint64_t stride = (uint64_t)STRIDE_BLOCKS * out->blockSize;
+  uint64_t perPass = out->footprint / stride;
+
+  for (uint64_t i = 0; ; i++) {
+    uint64_t word = i / perPass * WORD_SIZE % out->blockSize;
+    if (emit(out, i % perPass * stride + word, MODE_READ))
+      return;
+  }
+}
+
+static void generateRandom(Emitter *out) {
+  while (!emit(out, randomWord(out, out->footprint), randomMode(out)))
+    ;
+}
+
+/* Block ranks are drawn from a Zipf distribution over every block, then
+   spread over the footprint so the hot blocks are not all neighbours */
+static void generateZipf(Emitter *out) {
+  uint64_t blocks = out->footprint / out->blockSize;
+  double *cdf = malloc(blocks * sizeof(double));
+  double sum = 0.0;
+
+  if (cdf == NULL) {
+    fprintf(stderr, "zipf: out of memory\n");
+    exit(-1);
+  }
+  for (uint64_t rank = 0; rank < blocks; rank++) {
+    sum += 1.0 / pow((double)(rank + 1), ZIPF_THETA);
+    cdf[rank] = sum;
+  }
+  for (;;) {
+    double target = (nextRandom(out) >> 11) * (1.0 / 9007199254740992.0) * sum;   // 53 bits in [0, sum)
+    uint64_t low = 0, high = blocks - 1;
+    while (low < high) {
+      uint64_t middle = (low + high) / 2;
+      if (cdf[middle] < target)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    uint64_t block = low * 0x9E3779B97F4A7C15ULL & (blocks - 1);   // odd multiplier: a permutation
+    if (emit(out, block * out->blockSize + randomWord(out, out->blockSize), randomMode(out)))
+      break;
+  }
+  free(cdf);
+}
+
+/* Sattolo's shuffle gives a single cycle, so the chase visits every block */
+static void generateChase(Emitter *out) {
+  uint64_t blocks = out->footprint / out->blockSize;
+  uint32_t *next = malloc(blocks * sizeof(uint32_t));
+  uint64_t node = 0;
+
+  if (next == NULL) {
+    fprintf(stderr, "chase: out of memory\n");
+    exit(-1);
+  }
+  for (uint64_t i = 0; i < blocks; i++)
+    next[i] = (uint32_t)i;
+  for (uint64_t i = blocks - 1; i > 0; i--) {
+    uint64_t j = nextRandom(out) % i;
+    uint32_t swap = next[i];
+    next[i] = next[j];
+    next[j] = swap;
+  }
+  while (!emit(out, node * out->blockSize, MODE_READ))
+    node = next[node];
+  free(next);
+}
+
+static void generateMatmul(Emitter *out) {
+  uint64_t n = getMatrixSide(out->footprint, 3);
+  uint64_t tile = n < TILE ? n : TILE;
+  uint64_t A = 0, B = n * n * WORD_SIZE, C = 2 * n * n * WORD_SIZE;
+
+  for (;;) {
+    for (uint64_t ii = 0; ii < n; ii += tile)
+      for (uint64_t jj = 0; jj < n; jj += tile)
+        for (uint64_t kk = 0; kk < n; kk += tile)
+          for (uint64_t i = ii; i < ii + tile; i++)
+            for (uint64_t j = jj; j < jj + tile; j++) {
+              if (emit(out, C + (i * n + j) * WORD_SIZE, MODE_READ))
+                return;
+              for (uint64_t k = kk; k < kk + tile; k++) {
+                if (emit(out, A + (i * n + k) * WORD_SIZE, MODE_READ) ||
+                    emit(out, B + (k * n + j) * WORD_SIZE, MODE_READ))
+                  return;
+              }
+              if (emit(out, C + (i * n + j) * WORD_SIZE, MODE_WRITE))
+                return;
+            }
+  }
+}
+
+static void generateStencil(Emitter *out) {
+  uint64_t n = getMatrixSide(out->footprint, 2);
+  uint64_t from = 0, to = n * n * WORD_SIZE;
+
+  if (n < 3) {
+    fprintf(stderr, "stencil: footprint too small\n");
+    exit(-1);
+  }
+  for (;;) {
+    for (uint64_t i = 1; i + 1 < n; i++)
+      for (uint64_t j = 1; j + 1 < n; j++) {
+        uint64_t centre = from + (i * n + j) * WORD_SIZE;
+        if (emit(out, centre - n * WORD_SIZE, MODE_READ) || emit(out, centre - WORD_SIZE, MODE_READ) ||
+            emit(out, centre, MODE_READ) || emit(out, centre + WORD_SIZE, MODE_READ) ||
+            emit(out, centre + n * WORD_SIZE, MODE_READ) ||
+            emit(out, to + (i * n + j) * WORD_SIZE, MODE_WRITE))
+          return;
+      }
+    uint64_t swap = from;
+    from = to;
+    to = swap;
+  }
+}
+
+static const Kernel Kernels[] = {
+  { "sequential", generateSequential },
+  { "strided", generateStrided },
+  { "random", generateRandom },
+  { "zipf", generateZipf },
+  { "chase", generateChase },
+  { "matmul", generateMatmul },
+  { "stencil", generateStencil },
+  { NULL, NULL }
+};
+
+static const Kernel *findKernel(const char *name) {
+  for (const Kernel *kernel = Kernels; kernel->name != NULL; kernel++)
+    if (strcmp(name, kernel->name) == 0)
+      return kernel;
+  return NULL;
+}
+
+/*********************** Runs *************************/
+
+static double elapsedSeconds(struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static double getMissRate(const LevelStats *Stats) {
+  uint64_t misses = Stats->misses[MODE_READ] + Stats->misses[MODE_WRITE];
+  uint64_t accesses = misses + Stats->hits[MODE_READ] + Stats->hits[MODE_WRITE];
+  return accesses ? (double)misses / accesses : 0.0;
+}
+
+/* Simulates the accesses repetitions times from empty caches, returns the
+   fastest run in seconds; Sim keeps the statistics of the last one */
+static double runKernel(Simulator *Sim, const Emitter *accesses, uint8_t *data, int repetitions) {
+  double best = 0.0;
+
+  for (int rep = 0; rep < repetitions; rep++) {
+    struct timespec start;
+    resetSimulator(Sim);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    accessSimulatorBatch(Sim, 0, accesses->addresses, accesses->modes, data, accesses->length);
+    double seconds = elapsedSeconds(&start);
+    if (rep == 0 || seconds < best)
+      best = seconds;
+  }
+  return best;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: Bench [-c config] [-s name=value]... [-n accesses] [-f bytes] [-r repetitions]\n");
+  fprintf(stderr, "             [-x csv] [kernel...]\n");
+  fprintf(stderr, "kernels:");
+  for (const Kernel *kernel = Kernels; kernel->name != NULL; kernel++)
+    fprintf(stderr, " %s", kernel->name);
+  fprintf(stderr, "\n");
+  exit(-1);
+}
+
+int main(int argc, char **argv) {
+
+  CacheConfig config = getDefaultConfig();
+  const char *csvPath = NULL;
+  size_t count = ACCESSES;
+  uint64_t footprint = 0;
+  int repetitions = REPETITIONS;
+  FILE *csv = NULL;
+  int header = 0;
+
+  while (argc > 2 && argv[1][0] == '-' && argv[1][1] != '\0') {
+    if (strcmp(argv[1], "-c") == 0 && loadConfigFile(&config, argv[2]) == 0)
+      ;
+    else if (strcmp(argv[1], "-s") == 0 && parseConfigOption(&config, argv[2]) == 0)
+      ;
+    else if (strcmp(argv[1], "-n") == 0)
+      count = strtoull(argv[2], NULL, 0);
+    else if (strcmp(argv[1], "-f") == 0)
+      footprint = strtoull(argv[2], NULL, 0);
+    else if (strcmp(argv[1], "-r") == 0)
+      repetitions = atoi(argv[2]);
+    else if (strcmp(argv[1], "-x") == 0)
+      csvPath = argv[2];
+    else
+      usage();
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc > 1 && argv[1][0] == '-')
+    usage();
+  for (int i = 1; i < argc; i++)
+    if (findKernel(argv[i]) == NULL)
+      usage();
+
+  if (footprint == 0)
+    footprint = config.dramSize != 0 ? config.dramSize : FOOTPRINT;
+  if (count == 0 || repetitions < 1 || (footprint & (footprint - 1)) != 0 ||
+      footprint < (uint64_t)STRIDE_BLOCKS * config.blockSize ||
+      (config.dramSize != 0 && footprint > config.dramSize)) {
+    fprintf(stderr, "Bench: the footprint must be a power of two, at least %u blocks and within dram_size\n",
+            STRIDE_BLOCKS);
+    return -1;
+  }
+
+  Simulator *Sim = createSimulator(&config);
+  Emitter accesses;
+  accesses.addresses = malloc(count * sizeof(uint64_t));
+  accesses.modes = malloc(count);
+  uint8_t *data = calloc(count, WORD_SIZE);
+  if (Sim == NULL || accesses.addresses == NULL || accesses.modes == NULL || data == NULL) {
+    fprintf(stderr, "Bench: out of memory\n");
+    return -1;
+  }
+  accesses.count = count;
+  accesses.footprint = footprint;
+  accesses.blockSize = config.blockSize;
+
+  if (csvPath != NULL) {
+    csv = strcmp(csvPath, "-") == 0 ? stdout : fopen(csvPath, "w");
+    if (csv == NULL) {
+      perror(csvPath);
+      return -1;
+    }
+  }
+
+  printf("%-11s %10s %8s %8s %9s %12s", "kernel", "accesses", "l1_miss", "l2_miss", "amat", "time");
+  if (config.timing == TIMING_EVENT)
+    printf(" %12s", "cycles");
+  printf(" %12s\n", "accesses/s");
+
+  for (const Kernel *kernel = Kernels; kernel->name != NULL; kernel++) {
+    int selected = argc == 1;
+    for (int i = 1; i < argc; i++)
+      selected |= strcmp(argv[i], kernel->name) == 0;
+    if (!selected)
+      continue;
+
+    accesses.length = 0;
+    accesses.random = SEED;
+    kernel->generate(&accesses);
+    double seconds = runKernel(Sim, &accesses, data, repetitions);
+    double rate = seconds > 0 ? accesses.length / seconds : 0.0;
+    StatsReport Report = getSimulatorStats(Sim);
+
+    printf("%-11s %10zu %8.4f %8.4f %9.3f %12llu", kernel->name, accesses.length,
+           getMissRate(Report.levels[0]),
+           Report.levels[Report.cores] != NULL ? getMissRate(Report.levels[Report.cores]) : 0.0,
+           (double)Report.time / accesses.length, (unsigned long long)Report.time);
+    if (config.timing == TIMING_EVENT)
+      printf(" %12llu", (unsigned long long)Report.cycles);
+    printf(" %12.0f\n", rate);
+
+    if (csv != NULL) {
+      if (!header) {
+        fprintf(csv, "kernel,host_seconds,accesses_per_sec,");
+        printStatsCSVHeader(csv, &Report);
+        header = 1;
+      }
+      fprintf(csv, "%s,%.6f,%.0f,", kernel->name, seconds, rate);
+      printStatsCSV(csv, &Report);
+    }
+  }
+
+  if (csv != NULL && csv != stdout)
+    fclose(csv);
+  free(accesses.addresses);
+  free(accesses.modes);
+  free(data);
+  freeSimulator(Sim);
+  return 0;
+}
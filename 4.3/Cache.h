@@ -7,6 +7,26 @@
 #define L1_SIZE (256 * BLOCK_SIZE)      // in bytes
 #define L2_SIZE (512 * BLOCK_SIZE)    // in bytes
 
+#define L1_WAYS 1                     // 1 = direct mapped, 0 = fully associative
+#define L2_WAYS 2
+#define L1_REPLACEMENT REPLACEMENT_LRU
+#define L2_REPLACEMENT REPLACEMENT_LRU
+#define L1_PREFETCHER PREFETCH_NONE
+#define L2_PREFETCHER PREFETCH_NONE
+#define PREFETCH_DEGREE 4             // blocks fetched ahead when a prefetcher is on
+#define WRITE_BUFFER_ENTRIES 0        // per level, 0 writes back synchronously
+#define VICTIM_ENTRIES 0              // per level, 0 for no victim cache
+#define WRITE_POLICY WRITE_BACK
+#define WRITE_MISS_POLICY WRITE_ALLOCATE
+#define INCLUSION INCLUSION_NINE      // of the L1s in the L2
+#define TIMING TIMING_ADDITIVE        // TIMING_EVENT also runs the MSHR model
+#define PAGES ARENA_PAGES_NORMAL      // ARENA_PAGES_THP or _HUGETLB back the simulator with huge pages
+#define L1_MSHRS 8                    // outstanding misses per level, event timing only
+#define L2_MSHRS 16
+
+#define CORES 1                       // private L1s sharing the L2
+#define LEVELS 2                      // 1 leaves out the L2
+
 #define MODE_READ 1
 #define MODE_WRITE 0
 
@@ -16,5 +36,6 @@
 #define L2_WRITE_TIME 5
 #define L1_READ_TIME 1
 #define L1_WRITE_TIME 1
+#define TRANSFER_TIME 10              // L1 to L1, for coherence
 
 #endif
@@ -0,0 +1,285 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Checkpoint.h"
+
+#define MAX_LEVEL_ARRAYS 13
+
+/* Fixed part of a snapshot. Then come, each at a PAGE_SIZE boundary: for
+   every level the raw CacheLevel followed by its arrays, the event queue,
+   the latency histograms when they are on, the DRAM page numbers and the
+   DRAM pages. */
+typedef struct SnapshotHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t levelSize;       // sizeof(CacheLevel), the build check
+  uint32_t events;          // queued timing events
+  uint64_t pages;           // DRAM pages
+  uint64_t fileSize;
+  CacheConfig config;
+  uint64_t time;
+  uint64_t cycles;
+  uint64_t statsTime;
+  uint64_t statsCycles;
+  uint64_t issue[MAX_CORES];
+  DRAMStats memoryStats;
+  CoherenceStats coherence;
+} SnapshotHeader;
+
+/* One array of a level. heap arrays belong to the level and are copied;
+   the others come from the arena and are pointed into the mapping. */
+typedef struct SnapshotArray {
+  void **field;
+  size_t size;
+  uint32_t heap;
+} SnapshotArray;
+
+/* The arrays of Cache in file order, decided by its geometry and by config
+   so that garbage pointers in a saved CacheLevel do not matter */
+static uint32_t listArrays(CacheLevel *Cache, const CacheConfig *config, SnapshotArray *arrays) {
+    uint32_t count = 0;
+
+#define ARRAY(pointer, bytes, onHeap) \
+    arrays[count++] = (SnapshotArray){ (void **)&(pointer), (bytes), (onHeap) }
+    ARRAY(Cache->tags, Cache->numLines * sizeof(uint64_t), 0);
+    ARRAY(Cache->lines, Cache->numLines * sizeof(CacheLine), 0);
+    ARRAY(Cache->sets, Cache->numSets * sizeof(CacheSet), 0);
+    ARRAY(Cache->plru, (size_t)Cache->numSets * Cache->plruWords * sizeof(uint64_t), 0);
+    if (!config->tagOnly)
+        ARRAY(Cache->data, Cache->size, 0);
+    if (Cache->prefetch.type != PREFETCH_NONE)
+        ARRAY(Cache->ready, Cache->numLines * sizeof(uint64_t), 0);
+    if (Cache->writeBuffer.entries)
+        ARRAY(Cache->writeBuffer.done, Cache->writeBuffer.entries * sizeof(uint64_t), 0);
+    if (Cache->victims.entries) {
+        ARRAY(Cache->victims.blocks, Cache->victims.entries * sizeof(uint64_t), 0);
+        ARRAY(Cache->victims.dirty, Cache->victims.entries, 0);
+        if (!config->tagOnly)
+            ARRAY(Cache->victims.data, (size_t)Cache->victims.entries * config->blockSize, 0);
+    }
+    if (config->timing == TIMING_EVENT) {
+        ARRAY(Cache->mshrs.blocks, Cache->mshrs.entries * sizeof(uint64_t), 1);
+        ARRAY(Cache->mshrs.done, Cache->mshrs.entries * sizeof(uint64_t), 1);
+    }
+#undef ARRAY
+    return count;
+}
+
+static uint32_t getLevels(const Simulator *Sim, CacheLevel **levels) {
+    uint32_t count = 0;
+
+    for (uint32_t core = 0; core < Sim->numCores; core++)
+        levels[count++] = (CacheLevel *)&Sim->L1[core];
+    if (Sim->config.levels > 1)
+        levels[count++] = (CacheLevel *)&Sim->L2;
+    return count;
+}
+
+static uint64_t alignPage(uint64_t offset) {
+    return (offset + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+}
+
+/*********************** Save *************************/
+
+/* Writes size bytes at the next page boundary, data may be NULL when size is 0 */
+static int writeAligned(FILE *out, uint64_t *offset, const void *data, size_t size) {
+    static const uint8_t zeros[PAGE_SIZE];
+    uint64_t start = alignPage(*offset);
+
+    if (fwrite(zeros, 1, start - *offset, out) != start - *offset || (size > 0 && fwrite(data, 1, size, out) != size))
+        return -1;
+    *offset = start + size;
+    return 0;
+}
+
+int saveSimulator(const Simulator *Sim, const char *path) {
+    SnapshotHeader header;
+    CacheLevel *levels[MAX_CORES + 1];
+    SnapshotArray arrays[MAX_LEVEL_ARRAYS];
+    const HashMap *Pages = &Sim->DRAM.pages;
+    uint64_t offset = 0;
+    int failed = 0;
+
+    if (!Sim->configured || Sim->config.classifyMisses) {
+        fprintf(stderr, "saveSimulator: needs a configured simulator without classify_misses\n");
+        return -1;
+    }
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.levelSize = sizeof(CacheLevel);
+    header.events = Sim->events.count;
+    header.pages = Sim->config.tagOnly ? 0 : Pages->count;
+    header.config = Sim->config;
+    header.time = Sim->time;
+    header.cycles = Sim->cycles;
+    header.statsTime = Sim->statsTime;
+    header.statsCycles = Sim->statsCycles;
+    memcpy(header.issue, Sim->issue, sizeof(header.issue));
+    header.memoryStats = Sim->memoryStats;
+    header.coherence = Sim->coherence;
+    failed |= fwrite(&header, sizeof(header), 1, out) != 1;     // fileSize is patched in at the end
+    offset = sizeof(header);
+
+    uint32_t count = getLevels(Sim, levels);
+    for (uint32_t l = 0; l < count && !failed; l++) {
+        failed |= writeAligned(out, &offset, levels[l], sizeof(CacheLevel));
+        uint32_t n = listArrays(levels[l], &Sim->config, arrays);
+        for (uint32_t a = 0; a < n && !failed; a++)
+            failed |= writeAligned(out, &offset, *arrays[a].field, arrays[a].size);
+    }
+    if (!failed)
+        failed |= writeAligned(out, &offset, Sim->events.events, Sim->events.count * sizeof(TimingEvent));
+    if (Sim->latency != NULL && !failed)
+        failed |= writeAligned(out, &offset, Sim->latency, sizeof(LatencyStats));
+
+    if (header.pages > 0 && !failed) {
+        uint64_t *numbers = malloc(header.pages * sizeof(uint64_t));
+        uint64_t n = 0;
+        failed |= numbers == NULL;
+        for (uint64_t slot = 0; !failed && slot <= Pages->mask; slot++)
+            if (Pages->keys[slot] != HASHMAP_EMPTY)
+                numbers[n++] = Pages->keys[slot];
+        if (!failed)
+            failed |= writeAligned(out, &offset, numbers, n * sizeof(uint64_t));
+        for (uint64_t p = 0; p < n && !failed; p++)
+            failed |= writeAligned(out, &offset, (const uint8_t *)(uintptr_t)*findHashMap(Pages, numbers[p]), PAGE_SIZE);
+        free(numbers);
+    }
+
+    header.fileSize = offset;
+    failed |= fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, out) != 1;
+    failed |= fclose(out) != 0;
+    if (failed) {
+        fprintf(stderr, "saveSimulator: cannot write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/*********************** Restore *************************/
+
+/* The next size bytes of the mapping at a page boundary, NULL past its end */
+static uint8_t *takeAligned(uint8_t *base, uint64_t size, uint64_t *offset, uint64_t bytes) {
+    uint64_t start = alignPage(*offset);
+
+    if (start > size || bytes > size - start)
+        return NULL;
+    *offset = start + bytes;
+    return base + start;
+}
+
+static int restoreLevel(CacheLevel *Cache, const CacheConfig *config, uint8_t *base, uint64_t size, uint64_t *offset) {
+    SnapshotArray fresh[MAX_LEVEL_ARRAYS], arrays[MAX_LEVEL_ARRAYS];
+    CacheLevel Fresh = *Cache;
+    uint8_t *saved = takeAligned(base, size, offset, sizeof(CacheLevel));
+
+    if (saved == NULL)
+        return -1;
+    uint32_t n = listArrays(&Fresh, config, fresh);
+    memcpy(Cache, saved, sizeof(CacheLevel));
+    Cache->next = Fresh.next;
+    Cache->sim = Fresh.sim;
+    Cache->classifier = Fresh.classifier;
+    if (listArrays(Cache, config, arrays) != n)
+        return -1;
+
+    for (uint32_t a = 0; a < n; a++) {
+        uint8_t *array = takeAligned(base, size, offset, arrays[a].size);
+        if (array == NULL || arrays[a].size != fresh[a].size)
+            return -1;
+        if (arrays[a].heap) {
+            *arrays[a].field = *fresh[a].field;
+            memcpy(*arrays[a].field, array, arrays[a].size);
+        } else {
+            *arrays[a].field = array;       // the arena copy is left untouched
+        }
+    }
+    return 0;
+}
+
+/* Replaces Sim with the snapshot at path. On failure Sim is left cleaned up. */
+int restoreSimulator(Simulator *Sim, const char *path) {
+    struct stat info;
+    SnapshotHeader header;
+    CacheLevel *levels[MAX_CORES + 1];
+    FILE *in = fopen(path, "rb");      // not open(): unistd.h declares its own read() and write()
+
+    if (in == NULL || fstat(fileno(in), &info) != 0) {
+        perror(path);
+        if (in != NULL)
+            fclose(in);
+        return -1;
+    }
+    uint64_t size = (uint64_t)info.st_size;
+    uint8_t *base = size >= sizeof(header) ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(in), 0) : MAP_FAILED;
+    fclose(in);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "restoreSimulator: cannot map %s\n", path);
+        return -1;
+    }
+    memcpy(&header, base, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION ||
+        header.levelSize != sizeof(CacheLevel) || header.fileSize != size) {
+        fprintf(stderr, "restoreSimulator: %s is not a snapshot of this build\n", path);
+        munmap(base, size);
+        return -1;
+    }
+    if (setupSimulator(Sim, &header.config) != 0 || header.events > Sim->events.capacity) {
+        munmap(base, size);
+        return -1;
+    }
+    Sim->snapshot = base;
+    Sim->snapshotSize = size;
+
+    uint64_t offset = sizeof(header);
+    int failed = 0;
+    uint32_t count = getLevels(Sim, levels);
+    for (uint32_t l = 0; l < count && !failed; l++)
+        failed = restoreLevel(levels[l], &Sim->config, base, size, &offset);
+
+    uint8_t *events = failed ? NULL : takeAligned(base, size, &offset, header.events * sizeof(TimingEvent));
+    failed = failed || events == NULL;
+    if (!failed && header.events > 0) {
+        memcpy(Sim->events.events, events, header.events * sizeof(TimingEvent));
+        Sim->events.count = header.events;
+    }
+    if (!failed && Sim->latency != NULL) {
+        uint8_t *latency = takeAligned(base, size, &offset, sizeof(LatencyStats));
+        failed = latency == NULL;
+        if (!failed)
+            memcpy(Sim->latency, latency, sizeof(LatencyStats));
+    }
+
+    if (!failed && header.pages > 0) {
+        uint64_t *numbers = (uint64_t *)takeAligned(base, size, &offset, header.pages * sizeof(uint64_t));
+        failed = numbers == NULL;
+        for (uint64_t p = 0; p < header.pages && !failed; p++) {
+            int inserted;
+            uint8_t *page = takeAligned(base, size, &offset, PAGE_SIZE);
+            uint64_t *Value = page != NULL ? insertHashMap(&Sim->DRAM.pages, numbers[p], &inserted) : NULL;
+            failed = Value == NULL;
+            if (!failed)
+                *Value = (uint64_t)(uintptr_t)page;
+        }
+    }
+    if (failed) {
+        fprintf(stderr, "restoreSimulator: %s is truncated or corrupt\n", path);
+        cleanupSimulator(Sim);
+        return -1;
+    }
+
+    Sim->time = header.time;
+    Sim->cycles = header.cycles;
+    Sim->statsTime = header.statsTime;
+    Sim->statsCycles = header.statsCycles;
+    memcpy(Sim->issue, header.issue, sizeof(Sim->issue));
+    Sim->memoryStats = header.memoryStats;
+    Sim->coherence = header.coherence;
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "4.3Cache.h"
+
+/* Snapshots of a whole simulator: configuration, clocks, every cache array
+   (tags, lines, replacement state, data), write buffers, victim caches,
+   MSHRs, statistics (latency histograms included) and the touched DRAM
+   pages. Arrays sit page aligned in the file, so a restore maps it
+   privately and points the simulator into the mapping: it takes
+   milliseconds whatever the size, and pages are only read (and copied
+   when written) as the run touches them. A snapshot is
+   only read back by the build that wrote it. Miss classification state is
+   not saved, so simulators with classify_misses are refused. */
+
+#define SNAPSHOT_MAGIC 0x50414e53     // "SNAP"
+#define SNAPSHOT_VERSION 3
+
+int saveSimulator(const Simulator *, const char *);
+
+int restoreSimulator(Simulator *, const char *);
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <string.h>
+#include "HashMap.h"
+
+static uint64_t hashKey(uint64_t key, uint64_t mask) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return key & mask;
+}
+
+/* capacity is rounded up to a power of two */
+int initHashMap(HashMap *Map, uint64_t capacity) {
+    uint64_t size = 16;
+
+    while (size < capacity)
+        size <<= 1;
+    Map->keys = malloc(size * sizeof(uint64_t));
+    Map->values = malloc(size * sizeof(uint64_t));
+    if (Map->keys == NULL || Map->values == NULL) {
+        freeHashMap(Map);
+        return -1;
+    }
+    Map->mask = size - 1;
+    clearHashMap(Map);
+    return 0;
+}
+
+void freeHashMap(HashMap *Map) {
+    free(Map->keys);
+    free(Map->values);
+    memset(Map, 0, sizeof(*Map));
+}
+
+void clearHashMap(HashMap *Map) {
+    memset(Map->keys, 0xFF, (Map->mask + 1) * sizeof(uint64_t));
+    Map->count = 0;
+}
+
+/* Pointer to the value of key, NULL if absent. Valid until the next insert or remove. */
+uint64_t *findHashMap(const HashMap *Map, uint64_t key) {
+    for (uint64_t slot = hashKey(key, Map->mask); ; slot = (slot + 1) & Map->mask) {
+        if (Map->keys[slot] == key)
+            return &Map->values[slot];
+        if (Map->keys[slot] == HASHMAP_EMPTY)
+            return NULL;
+    }
+}
+
+static int growHashMap(HashMap *Map) {
+    HashMap Bigger;
+
+    if (initHashMap(&Bigger, (Map->mask + 1) * 2) != 0)
+        return -1;
+    for (uint64_t slot = 0; slot <= Map->mask; slot++) {
+        if (Map->keys[slot] != HASHMAP_EMPTY) {
+            uint64_t to = hashKey(Map->keys[slot], Bigger.mask);
+            while (Bigger.keys[to] != HASHMAP_EMPTY)
+                to = (to + 1) & Bigger.mask;
+            Bigger.keys[to] = Map->keys[slot];
+            Bigger.values[to] = Map->values[slot];
+        }
+    }
+    Bigger.count = Map->count;
+    freeHashMap(Map);
+    *Map = Bigger;
+    return 0;
+}
+
+/* Finds key or adds it with value 0 (*inserted tells which).
+   Returns NULL only when the table can not grow. */
+uint64_t *insertHashMap(HashMap *Map, uint64_t key, int *inserted) {
+    if ((Map->count + 1) * 2 > Map->mask + 1 && growHashMap(Map) != 0)
+        return NULL;
+
+    uint64_t slot = hashKey(key, Map->mask);
+    for (; Map->keys[slot] != HASHMAP_EMPTY; slot = (slot + 1) & Map->mask) {
+        if (Map->keys[slot] == key) {
+            *inserted = 0;
+            return &Map->values[slot];
+        }
+    }
+    Map->keys[slot] = key;
+    Map->values[slot] = 0;
+    Map->count++;
+    *inserted = 1;
+    return &Map->values[slot];
+}
+
+/* Backward shift deletion, so no tombstones are left behind */
+void removeHashMap(HashMap *Map, uint64_t key) {
+    uint64_t slot = hashKey(key, Map->mask);
+
+    while (Map->keys[slot] != key) {
+        if (Map->keys[slot] == HASHMAP_EMPTY)
+            return;
+        slot = (slot + 1) & Map->mask;
+    }
+    Map->count--;
+
+    for (uint64_t next = (slot + 1) & Map->mask; Map->keys[next] != HASHMAP_EMPTY; next = (next + 1) & Map->mask) {
+        uint64_t home = hashKey(Map->keys[next], Map->mask);
+        /* move next into the hole unless its home lies cyclically in (slot, next] */
+        if (((next - home) & Map->mask) >= ((next - slot) & Map->mask)) {
+            Map->keys[slot] = Map->keys[next];
+            Map->values[slot] = Map->values[next];
+            slot = next;
+        }
+    }
+    Map->keys[slot] = HASHMAP_EMPTY;
+}
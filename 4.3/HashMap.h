@@ -0,0 +1,30 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stdint.h>
+
+/* Open addressing (linear probing) map from 64 bit keys to 64 bit values.
+   HASHMAP_EMPTY can not be used as a key. */
+
+#define HASHMAP_EMPTY UINT64_MAX
+
+typedef struct HashMap {
+  uint64_t *keys;
+  uint64_t *values;
+  uint64_t mask;      // capacity - 1, capacity is a power of two
+  uint64_t count;
+} HashMap;
+
+int initHashMap(HashMap *, uint64_t);
+
+void freeHashMap(HashMap *);
+
+void clearHashMap(HashMap *);
+
+uint64_t *findHashMap(const HashMap *, uint64_t);
+
+uint64_t *insertHashMap(HashMap *, uint64_t, int *);
+
+void removeHashMap(HashMap *, uint64_t);
+
+#endif
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Memory.h"
+
+/* pages is ARENA_PAGES_*, what backs the pages */
+int initMemory(SparseMemory *Memory, uint32_t pages) {
+    Memory->lastNumber = UINT64_MAX;
+    Memory->lastPage = NULL;
+    initArena(&Memory->arena, pages);
+    return initHashMap(&Memory->pages, 1024);
+}
+
+void freeMemory(SparseMemory *Memory) {
+    freeArena(&Memory->arena);
+    freeHashMap(&Memory->pages);
+    Memory->lastNumber = UINT64_MAX;
+    Memory->lastPage = NULL;
+}
+
+/* Bytes of backing store actually allocated */
+uint64_t getMemoryFootprint(const SparseMemory *Memory) {
+    return Memory->pages.count * PAGE_SIZE;
+}
+
+static uint8_t *findPage(SparseMemory *Memory, uint64_t number) {
+    if (number == Memory->lastNumber)
+        return Memory->lastPage;
+
+    uint64_t *Value = findHashMap(&Memory->pages, number);
+    if (Value == NULL)
+        return NULL;
+    Memory->lastNumber = number;
+    Memory->lastPage = (uint8_t *)(uintptr_t)*Value;
+    return Memory->lastPage;
+}
+
+static uint8_t *allocPage(SparseMemory *Memory, uint64_t number) {
+    int inserted;
+    uint8_t *Page = findPage(Memory, number);
+
+    if (Page != NULL)
+        return Page;
+    Page = allocArena(&Memory->arena, PAGE_SIZE);
+    if (Page == NULL)
+        return NULL;
+    uint64_t *Value = insertHashMap(&Memory->pages, number, &inserted);
+    if (Value == NULL)
+        return NULL;        // the page goes back with the arena
+    *Value = (uint64_t)(uintptr_t)Page;
+    Memory->lastNumber = number;
+    Memory->lastPage = Page;
+    return Page;
+}
+
+/* Accesses may cross page boundaries */
+void readMemory(SparseMemory *Memory, uint64_t address, uint8_t *data, uint32_t size) {
+    while (size > 0) {
+        uint32_t offset = address & (PAGE_SIZE - 1);
+        uint32_t chunk = PAGE_SIZE - offset < size ? PAGE_SIZE - offset : size;
+        uint8_t *Page = findPage(Memory, address >> PAGE_BITS);
+
+        if (Page != NULL)
+            memcpy(data, Page + offset, chunk);
+        else
+            memset(data, 0, chunk);
+        address += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+int writeMemory(SparseMemory *Memory, uint64_t address, const uint8_t *data, uint32_t size) {
+    while (size > 0) {
+        uint32_t offset = address & (PAGE_SIZE - 1);
+        uint32_t chunk = PAGE_SIZE - offset < size ? PAGE_SIZE - offset : size;
+        uint8_t *Page = allocPage(Memory, address >> PAGE_BITS);
+
+        if (Page == NULL)
+            return -1;
+        memcpy(Page + offset, data, chunk);
+        address += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return 0;
+}
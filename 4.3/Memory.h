@@ -0,0 +1,33 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdint.h>
+#include "HashMap.h"
+#include "Arena.h"
+
+/* Sparse byte addressable backing store: 4 KiB pages are allocated on the
+   first write, so memory follows the touched footprint and not the address
+   range. Untouched memory reads as zeros. The pages come from an arena, so
+   neighbouring ones share huge pages when the arena is backed by them. */
+
+#define PAGE_BITS 12
+#define PAGE_SIZE (1 << PAGE_BITS)
+
+typedef struct SparseMemory {
+  HashMap pages;          // page number -> page pointer
+  uint64_t lastNumber;    // one entry lookup cache
+  uint8_t *lastPage;
+  Arena arena;            // the pages
+} SparseMemory;
+
+int initMemory(SparseMemory *, uint32_t);
+
+void freeMemory(SparseMemory *);
+
+uint64_t getMemoryFootprint(const SparseMemory *);
+
+void readMemory(SparseMemory *, uint64_t, uint8_t *, uint32_t);
+
+int writeMemory(SparseMemory *, uint64_t, const uint8_t *, uint32_t);
+
+#endif
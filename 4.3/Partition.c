@@ -0,0 +1,188 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include "Partition.h"
+
+#define WORKER_BATCH 4096   // accesses a worker simulates per call
+
+/*********************** Queue *************************/
+
+static void pushEntries(SpscQueue *Queue, const uint64_t *entries, uint32_t count) {
+    size_t tail = atomic_load_explicit(&Queue->tail, memory_order_relaxed);
+
+    while (tail + count - atomic_load_explicit(&Queue->head, memory_order_acquire) > PARTITION_QUEUE_ENTRIES)
+        sched_yield();                      // full, the worker is behind
+    for (uint32_t i = 0; i < count; i++)
+        Queue->entries[(tail + i) & (PARTITION_QUEUE_ENTRIES - 1)] = entries[i];
+    atomic_store_explicit(&Queue->tail, tail + count, memory_order_release);
+}
+
+/*********************** Workers *************************/
+
+static void *runPartition(void *argument) {
+    Partition *Part = argument;
+    SpscQueue *Queue = &Part->queue;
+    uint64_t Addresses[WORKER_BATCH];
+    uint8_t Modes[WORKER_BATCH];
+    uint32_t Values[WORKER_BATCH];
+    size_t head = atomic_load_explicit(&Queue->head, memory_order_relaxed);
+
+    for (;;) {
+        int closed = atomic_load_explicit(&Queue->closed, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&Queue->tail, memory_order_acquire);
+        if (head == tail) {
+            if (closed)                     // closed is set after the last push
+                return NULL;
+            sched_yield();
+            continue;
+        }
+        size_t count = tail - head < WORKER_BATCH ? tail - head : WORKER_BATCH;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t entry = Queue->entries[(head + i) & (PARTITION_QUEUE_ENTRIES - 1)];
+            Addresses[i] = entry & ~(uint64_t)(WORD_SIZE - 1);
+            Modes[i] = (uint8_t)(entry & 1);
+            Values[i] = (uint32_t)Addresses[i];
+        }
+        head += count;
+        atomic_store_explicit(&Queue->head, head, memory_order_release);
+        accessSimulatorBatch(Part->sim, 0, Addresses, Modes, (uint8_t *)Values, count);
+    }
+}
+
+/*********************** Partitions *************************/
+
+static uint32_t getSets(const LevelConfig *level, uint32_t blockSize) {
+    return level->ways == 0 ? 1 : level->size / blockSize / level->ways;
+}
+
+static int checkPartitions(const CacheConfig *config, uint32_t count) {
+    if (count == 0 || count > MAX_PARTITIONS || (count & (count - 1)) != 0) {
+        fprintf(stderr, "createPartitions: the partitions must be a power of two up to %d\n", MAX_PARTITIONS);
+        return -1;
+    }
+    if (config->cores != 1 || config->timing != TIMING_ADDITIVE || config->classifyMisses ||
+        config->L1.prefetcher != PREFETCH_NONE || config->L2.prefetcher != PREFETCH_NONE ||
+        config->L1.victimEntries || config->L2.victimEntries || config->L1.writeBuffer || config->L2.writeBuffer ||
+        config->L1.replacement == REPLACEMENT_RANDOM || (config->levels > 1 && config->L2.replacement == REPLACEMENT_RANDOM)) {
+        fprintf(stderr, "createPartitions: needs one core, additive timing and no prefetchers, "
+                "victim caches, write buffers, random replacement or miss classification\n");
+        return -1;
+    }
+    if (config->blockSize == 0 || count > getSets(&config->L1, config->blockSize) ||
+        (config->levels > 1 && count > getSets(&config->L2, config->blockSize)) ||
+        (config->dramSize != 0 && config->dramSize / count < config->blockSize)) {
+        fprintf(stderr, "createPartitions: more partitions than sets\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* count partitions of config, their threads already waiting for accesses */
+PartitionedSimulator *createPartitions(const CacheConfig *config, uint32_t count) {
+    CacheConfig part = *config;
+
+    if (checkPartitions(config, count) != 0)
+        return NULL;
+    PartitionedSimulator *Sim = calloc(1, sizeof(PartitionedSimulator));
+    if (Sim == NULL)
+        return NULL;
+    Sim->count = count;
+    Sim->shift = getNumBits(count);
+    Sim->offsetBits = getNumBits(config->blockSize);
+    Sim->partitions = calloc(count, sizeof(Partition));
+    if (Sim->partitions == NULL) {
+        freePartitions(Sim);
+        return NULL;
+    }
+
+    part.L1.size /= count;
+    part.L2.size /= count;
+    part.dramSize /= count;
+    for (uint32_t i = 0; i < count; i++) {
+        Partition *Part = &Sim->partitions[i];
+        Part->sim = createSimulator(&part);
+        Part->queue.entries = malloc(PARTITION_QUEUE_ENTRIES * sizeof(uint64_t));
+        if (Part->sim == NULL || Part->queue.entries == NULL) {
+            freePartitions(Sim);
+            return NULL;
+        }
+        resetSimulator(Part->sim);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (pthread_create(&Sim->partitions[i].thread, NULL, runPartition, &Sim->partitions[i]) != 0) {
+            fprintf(stderr, "createPartitions: cannot start a thread\n");
+            freePartitions(Sim);
+            return NULL;
+        }
+        Sim->started++;
+    }
+    return Sim;
+}
+
+/* One word access, routed to the partition that owns its sets */
+void accessPartitions(PartitionedSimulator *Sim, uint64_t address, uint32_t mode) {
+    uint64_t block = address >> Sim->offsetBits;
+    Partition *Part = &Sim->partitions[block & (Sim->count - 1)];
+    uint64_t local = ((block >> Sim->shift) << Sim->offsetBits) | (address & (((uint64_t)1 << Sim->offsetBits) - 1));
+
+    Part->pending[Part->pendingCount++] = (local & ~(uint64_t)(WORD_SIZE - 1)) | (mode == MODE_READ);
+    if (Part->pendingCount == PARTITION_BATCH) {
+        pushEntries(&Part->queue, Part->pending, Part->pendingCount);
+        Part->pendingCount = 0;
+    }
+}
+
+/* Hands over what is left and waits for every partition to finish */
+void finishPartitions(PartitionedSimulator *Sim) {
+    for (uint32_t i = 0; i < Sim->count; i++) {
+        Partition *Part = &Sim->partitions[i];
+        pushEntries(&Part->queue, Part->pending, Part->pendingCount);
+        Part->pendingCount = 0;
+        atomic_store_explicit(&Part->queue.closed, 1, memory_order_release);
+    }
+    for (uint32_t i = 0; i < Sim->started; i++)
+        pthread_join(Sim->partitions[i].thread, NULL);
+    Sim->started = 0;
+}
+
+/* The statistics of the whole cache, call after finishPartitions */
+StatsReport getPartitionStats(PartitionedSimulator *Sim) {
+    StatsReport Report;
+
+    memset(&Report, 0, sizeof(Report));
+    memset(&Sim->L1, 0, sizeof(LevelStats));
+    memset(&Sim->L2, 0, sizeof(LevelStats));
+    memset(&Sim->memoryStats, 0, sizeof(DRAMStats));
+    memset(&Sim->latency, 0, sizeof(LatencyStats));
+    for (uint32_t i = 0; i < Sim->count; i++) {
+        const Simulator *Part = Sim->partitions[i].sim;
+        addLevelStats(&Sim->L1, &Part->L1[0].stats);
+        addLevelStats(&Sim->L2, &Part->L2.stats);
+        addDRAMStats(&Sim->memoryStats, &Part->memoryStats);
+        if (Part->latency != NULL)
+            addLatencyStats(&Sim->latency, Part->latency);
+        Report.time += getSimulatorTime(Part);     // additive: the sum of the access costs
+    }
+    Report.cores = 1;
+    Report.names[0] = "L1";
+    Report.levels[0] = &Sim->L1;
+    if (Sim->partitions[0].sim->config.levels > 1) {
+        Report.names[1] = "L2";
+        Report.levels[1] = &Sim->L2;
+    }
+    Report.dram = &Sim->memoryStats;
+    Report.latency = Sim->partitions[0].sim->latency != NULL ? &Sim->latency : NULL;
+    return Report;
+}
+
+void freePartitions(PartitionedSimulator *Sim) {
+    if (Sim == NULL)
+        return;
+    if (Sim->started)
+        finishPartitions(Sim);
+    for (uint32_t i = 0; Sim->partitions != NULL && i < Sim->count; i++) {
+        freeSimulator(Sim->partitions[i].sim);
+        free(Sim->partitions[i].queue.entries);
+    }
+    free(Sim->partitions);
+    free(Sim);
+}
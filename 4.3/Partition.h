@@ -0,0 +1,62 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "4.3Cache.h"
+
+/* Set partitioned simulation of one configuration on several threads.
+   The low bits of the block number pick a partition; as long as there are
+   no more partitions than sets in any level, every set of every level (and
+   every DRAM block) belongs to exactly one of them. Each partition is then
+   a simulator 1/count the size, fed by its own thread through a single
+   producer single consumer queue, with the partition bits taken out of
+   its addresses. Each one sees its accesses in trace order, so the merged
+   statistics do not depend on the threads. Only set local state can be
+   split that way: one core, additive timing, and no prefetchers, victim
+   caches, write buffers, miss classification or random replacement (its
+   generator is per level, so the victims would depend on the split). */
+
+#define PARTITION_QUEUE_ENTRIES 65536   // per partition, a power of two
+#define PARTITION_BATCH 1024            // accesses the producer hands over at once
+#define MAX_PARTITIONS 64
+
+/* Ring of packed word accesses (address | mode in bit 0) */
+typedef struct SpscQueue {
+  _Alignas(64) atomic_size_t head;      // next entry the consumer takes
+  _Alignas(64) atomic_size_t tail;      // next entry the producer fills
+  atomic_int closed;                    // no more entries will come
+  uint64_t *entries;
+} SpscQueue;
+
+typedef struct Partition {
+  Simulator *sim;
+  SpscQueue queue;
+  pthread_t thread;
+  uint32_t pendingCount;
+  uint64_t pending[PARTITION_BATCH];    // producer side, not queued yet
+} Partition;
+
+typedef struct PartitionedSimulator {
+  uint32_t count;
+  uint32_t shift;           // log2 count
+  uint32_t offsetBits;
+  uint32_t started;         // threads running
+  Partition *partitions;
+  LevelStats L1;            // merged by getPartitionStats
+  LevelStats L2;
+  DRAMStats memoryStats;
+  LatencyStats latency;     // merged too when latency_histograms is on
+} PartitionedSimulator;
+
+PartitionedSimulator *createPartitions(const CacheConfig *, uint32_t);
+
+void accessPartitions(PartitionedSimulator *, uint64_t, uint32_t);
+
+void finishPartitions(PartitionedSimulator *);
+
+StatsReport getPartitionStats(PartitionedSimulator *);
+
+void freePartitions(PartitionedSimulator *);
+
+#endif
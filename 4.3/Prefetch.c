@@ -0,0 +1,109 @@
+#include <string.h>
+#include "Prefetch.h"
+
+void initPrefetcher(Prefetcher *Prefetch, uint32_t type, uint32_t degree) {
+    memset(Prefetch, 0, sizeof(Prefetcher));
+    Prefetch->type = type;
+    Prefetch->degree = degree < 1 ? 1 : degree > MAX_PREFETCH_DEGREE ? MAX_PREFETCH_DEGREE : degree;
+    resetPrefetcher(Prefetch);
+}
+
+void resetPrefetcher(Prefetcher *Prefetch) {
+    Prefetch->lastBlock = UINT64_MAX;
+    Prefetch->lastStride = 0;
+    Prefetch->confidence = 0;
+    memset(Prefetch->streams, 0, sizeof(Prefetch->streams));
+    Prefetch->clock = 0;
+}
+
+/* degree blocks from block + step on, skipping any that would wrap */
+static uint32_t runAhead(const Prefetcher *Prefetch, uint64_t block, int64_t step, uint64_t *blocks) {
+    uint32_t count = 0;
+
+    for (uint32_t i = 1; i <= Prefetch->degree; i++) {
+        uint64_t target = block + (uint64_t)(step * (int64_t)i);
+        if ((step > 0 && target <= block) || (step < 0 && target >= block))
+            break;
+        blocks[count++] = target;
+    }
+    return count;
+}
+
+/* Two equal non zero distances in a row confirm a stride */
+static uint32_t predictStride(Prefetcher *Prefetch, uint64_t block, uint64_t *blocks) {
+    int64_t stride = (int64_t)(block - Prefetch->lastBlock);
+    uint32_t count = 0;
+
+    if (Prefetch->lastBlock != UINT64_MAX && stride != 0) {
+        if (stride == Prefetch->lastStride) {
+            if (Prefetch->confidence < 2)
+                Prefetch->confidence++;
+        } else {
+            Prefetch->confidence = 0;
+        }
+        if (Prefetch->confidence > 0)
+            count = runAhead(Prefetch, block, stride, blocks);
+        Prefetch->lastStride = stride;
+    }
+    Prefetch->lastBlock = block;
+    return count;
+}
+
+/* A trigger one block after (or before) a known stream extends it; anything
+   else starts a new candidate stream in place of the least recently used. */
+static uint32_t predictStream(Prefetcher *Prefetch, uint64_t block, uint64_t *blocks) {
+    StreamEntry *Oldest = &Prefetch->streams[0];
+
+    Prefetch->clock++;
+    for (int i = 0; i < STREAM_ENTRIES; i++) {
+        StreamEntry *Stream = &Prefetch->streams[i];
+        if (Stream->lastUse != 0 && Stream->next == block) {
+            Stream->confirmed = 1;
+            Stream->lastUse = Prefetch->clock;
+            Stream->next = block + (uint64_t)(int64_t)Stream->direction;
+            return runAhead(Prefetch, block, Stream->direction, blocks);
+        }
+        /* the block just after one already prefetched: the stream runs on */
+        if (Stream->confirmed && Stream->direction > 0 && block > Stream->next &&
+            block <= Stream->next + Prefetch->degree) {
+            Stream->lastUse = Prefetch->clock;
+            Stream->next = block + 1;
+            return runAhead(Prefetch, block, 1, blocks);
+        }
+        if (Stream->confirmed && Stream->direction < 0 && block < Stream->next &&
+            block + Prefetch->degree >= Stream->next) {
+            Stream->lastUse = Prefetch->clock;
+            Stream->next = block - 1;
+            return runAhead(Prefetch, block, -1, blocks);
+        }
+        if (Stream->lastUse < Oldest->lastUse)
+            Oldest = Stream;
+    }
+
+    /* a new candidate, direction from a neighbouring candidate if there is one */
+    Oldest->direction = 1;
+    for (int i = 0; i < STREAM_ENTRIES; i++) {
+        StreamEntry *Stream = &Prefetch->streams[i];
+        if (Stream->lastUse != 0 && !Stream->confirmed && Stream->next == block + 2)
+            Oldest->direction = -1;
+    }
+    Oldest->next = block + (uint64_t)(int64_t)Oldest->direction;
+    Oldest->confirmed = 0;
+    Oldest->lastUse = Prefetch->clock;
+    return 0;
+}
+
+/* Called with the block number of each trigger, writes the blocks worth
+   fetching to blocks (at least MAX_PREFETCH_DEGREE long) and returns how many */
+uint32_t predictPrefetches(Prefetcher *Prefetch, uint64_t block, uint64_t *blocks) {
+    switch (Prefetch->type) {
+    case PREFETCH_NEXT_LINE:
+        return runAhead(Prefetch, block, 1, blocks);
+    case PREFETCH_STRIDE:
+        return predictStride(Prefetch, block, blocks);
+    case PREFETCH_STREAM:
+        return predictStream(Prefetch, block, blocks);
+    default:
+        return 0;
+    }
+}
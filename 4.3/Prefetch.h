@@ -0,0 +1,42 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+
+/* Prefetchers watch the demand misses of a level (and first touches of
+   blocks they brought in) as a stream of block numbers, and predict which
+   blocks to fetch next. The level does the fills, this only decides. */
+
+#define PREFETCH_NONE 0
+#define PREFETCH_NEXT_LINE 1    // the next degree blocks after every trigger
+#define PREFETCH_STRIDE 2       // PC-less: a repeated distance between triggers
+#define PREFETCH_STREAM 3       // up to STREAM_ENTRIES ascending or descending runs
+#define NUM_PREFETCHERS 4
+
+#define STREAM_ENTRIES 8
+#define MAX_PREFETCH_DEGREE 16
+
+typedef struct StreamEntry {
+  uint64_t next;          // block expected next
+  int32_t direction;      // +1 or -1
+  uint32_t confirmed;     // seen twice in a row, prefetching
+  uint64_t lastUse;       // for replacing the oldest stream
+} StreamEntry;
+
+typedef struct Prefetcher {
+  uint32_t type;
+  uint32_t degree;        // blocks fetched ahead per trigger
+  uint64_t lastBlock;     // stride detector
+  int64_t lastStride;
+  uint32_t confidence;
+  StreamEntry streams[STREAM_ENTRIES];
+  uint64_t clock;
+} Prefetcher;
+
+void initPrefetcher(Prefetcher *, uint32_t, uint32_t);
+
+void resetPrefetcher(Prefetcher *);
+
+uint32_t predictPrefetches(Prefetcher *, uint64_t, uint64_t *);
+
+#endif
@@ -0,0 +1,341 @@
+#include <time.h>
+#include "4.3Cache.h"
+#include "Partition.h"
+#include "Checkpoint.h"
+#include "Sample.h"
+#include "../trace/Trace.h"
+
+/*
+ * Replays a binary trace (see trace/Trace.h) through a simulator instance.
+ * Addresses are folded into the DRAM size (kept whole with dram_size=0) and
+ * accesses wider than a word are split into word accesses. Use -v to print
+ * every access like 4.3Program.
+ *
+ * The geometry defaults to Cache.h and can be changed without rebuilding:
+ *   -c <file>        load name=value lines (see printConfig for the names)
+ *   -s name=value    set a single option, applied after -c
+ *
+ * -j <file> and -x <file> write the end of run statistics as JSON or CSV
+ * ("-" for stdout).
+ *
+ * With cores=N, a single trace sends each record to the core it names.
+ * Several trace files are instead interleaved one record at a time, file i
+ * running on core i.
+ *
+ * -t <threads> splits a single core replay by set index over that many
+ * threads (a power of two); the statistics are the same as with one, see
+ * Partition.h for the configurations this works for.
+ *
+ * -W <file> saves the simulator after the run and -R <file> starts from
+ * such a snapshot instead of empty caches, so one warm-up can serve many
+ * runs. The snapshot brings its own configuration (-c and -s are ignored)
+ * and its statistics are cleared: the simulator clock goes on from where
+ * it stopped, but Time and amat count from the restore.
+ *
+ * -p <period,warmup,window> samples a single core trace (see Sample.h):
+ * only the last window words of every period are measured, the rest
+ * just warm the tags, and the estimated totals are printed with their
+ * confidence intervals. It turns on tag_only and takes no -v or -t.
+ *
+ * With latency_histograms=1 every access's latency goes into a histogram by
+ * where it was served and its mode, and p50/p99/p99.9 are printed at the end
+ * (and put in the JSON).
+ */
+
+/* Splits one record into word accesses on its core, returns the word count */
+static uint32_t replayRecord(Simulator *Sim, const TraceRecord *record, uint32_t core, uint64_t mask, int verbose) {
+  uint32_t value;
+  uint32_t words = (record->size + WORD_SIZE - 1) / WORD_SIZE;
+  if (words == 0)
+    words = 1;
+
+  for (uint32_t w = 0; w < words; w++) {
+    uint64_t address = (record->address + w * WORD_SIZE) & mask & ~(uint64_t)(WORD_SIZE - 1);
+
+    if (record->mode == MODE_READ) {
+      accessSimulatorCore(Sim, core, address, (uint8_t *)(&value), MODE_READ);
+      if (verbose)
+        printf("Read; Address %llu; Value %d; Time %llu\n", (unsigned long long)address, value,
+               (unsigned long long)getSimulatorTime(Sim));
+    }
+    else {
+      value = (uint32_t)address;
+      accessSimulatorCore(Sim, core, address, (uint8_t *)(&value), MODE_WRITE);
+      if (verbose)
+        printf("Write; Address %llu; Value %d; Time %llu\n", (unsigned long long)address, value,
+               (unsigned long long)getSimulatorTime(Sim));
+    }
+  }
+  return words;
+}
+
+#define BATCH_ACCESSES 65536
+
+/* Words waiting for accessSimulatorBatch */
+typedef struct Batch {
+  uint64_t addresses[BATCH_ACCESSES];
+  uint8_t modes[BATCH_ACCESSES];
+  uint32_t values[BATCH_ACCESSES];
+  size_t count;
+} Batch;
+
+static void flushBatch(Simulator *Sim, Batch *batch) {
+  accessSimulatorBatch(Sim, 0, batch->addresses, batch->modes, (uint8_t *)batch->values, batch->count);
+  batch->count = 0;
+}
+
+/* Queues the words of one record, written values are the address as in replayRecord */
+static uint32_t batchRecord(Simulator *Sim, Batch *batch, const TraceRecord *record, uint64_t mask) {
+  uint32_t words = (record->size + WORD_SIZE - 1) / WORD_SIZE;
+  if (words == 0)
+    words = 1;
+
+  for (uint32_t w = 0; w < words; w++) {
+    uint64_t address = (record->address + w * WORD_SIZE) & mask & ~(uint64_t)(WORD_SIZE - 1);
+    if (batch->count == BATCH_ACCESSES)
+      flushBatch(Sim, batch);
+    batch->addresses[batch->count] = address;
+    batch->modes[batch->count] = record->mode;
+    batch->values[batch->count] = (uint32_t)address;
+    batch->count++;
+  }
+  return words;
+}
+
+/* Per core trace, for interleaving several files */
+typedef struct CoreTrace {
+  TraceReader reader;
+  const TraceRecord *records;
+  size_t count;
+  size_t next;
+  int done;
+} CoreTrace;
+
+static int writeStats(const StatsReport *Report, const char *path, uint32_t format) {
+  FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+
+  if (out == NULL) {
+    perror(path);
+    return -1;
+  }
+  if (format == STATS_CSV) {
+    printStatsCSVHeader(out, Report);
+    printStatsCSV(out, Report);
+  } else {
+    printStatsJSON(out, Report);
+  }
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
+
+static double elapsedSeconds(struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv) {
+
+  CoreTrace traces[MAX_CORES];
+  struct timespec start;
+  uint64_t accesses = 0;
+  int verbose = 0, threads = 1;
+  unsigned long long period = 0, warmup = 0, window = 0;
+  CacheConfig config = getDefaultConfig();
+  const char *jsonPath = NULL, *csvPath = NULL, *savePath = NULL, *restorePath = NULL;
+
+  while (argc > 2 && argv[1][0] == '-' && argv[1][1] != '\0') {
+    if (strcmp(argv[1], "-v") == 0) {
+      verbose = 1;
+      argc--;
+      argv++;
+    }
+    else if (strcmp(argv[1], "-c") == 0 && loadConfigFile(&config, argv[2]) == 0) {
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-s") == 0 && parseConfigOption(&config, argv[2]) == 0) {
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-j") == 0) {
+      jsonPath = argv[2];
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-x") == 0) {
+      csvPath = argv[2];
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-W") == 0) {
+      savePath = argv[2];
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-R") == 0) {
+      restorePath = argv[2];
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-p") == 0 && sscanf(argv[2], "%llu,%llu,%llu", &period, &warmup, &window) == 3) {
+      config.tagOnly = 1;
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-t") == 0) {
+      threads = atoi(argv[2]);
+      argc -= 2;
+      argv += 2;
+    }
+    else {
+      break;
+    }
+  }
+  uint32_t files = (uint32_t)argc - 1;
+  if (argc < 2 || threads < 1 || (threads > 1 && (files > 1 || verbose || savePath != NULL || restorePath != NULL)) ||
+      (period > 0 && (files > 1 || verbose || threads > 1))) {
+    fprintf(stderr, "usage: Replay [-v] [-t threads] [-p period,warmup,window] [-c config] [-s name=value]...\n");
+    fprintf(stderr, "              [-j json] [-x csv] [-R snapshot] [-W snapshot] <trace file | ->...\n");
+    fprintf(stderr, "       give one trace, or one per core; -t takes one trace and no -v, -R or -W,\n");
+    fprintf(stderr, "       -p one trace and no -v or -t\n");
+    return -1;
+  }
+  Simulator *Sim = NULL;
+  PartitionedSimulator *Parts = NULL;
+  if (threads > 1)
+    Parts = createPartitions(&config, (uint32_t)threads);
+  else
+    Sim = createSimulator(&config);
+  if (Sim == NULL && Parts == NULL)
+    return -1;
+  if (restorePath != NULL) {
+    if (restoreSimulator(Sim, restorePath) != 0)
+      return -1;
+    config = Sim->config;
+    resetSimulatorStats(Sim);
+  }
+  else if (Sim != NULL) {
+    resetSimulator(Sim);
+  }
+  static Sampler Sampling;
+  if (period > 0 && initSampler(&Sampling, Sim, period, warmup, window) != 0)
+    return -1;
+  if (files > 1 && files != config.cores) {
+    fprintf(stderr, "Replay: give one trace, or one per core (cores=%u)\n", config.cores);
+    return -1;
+  }
+  for (uint32_t i = 0; i < files; i++) {
+    memset(&traces[i], 0, sizeof(CoreTrace));
+    if (openTrace(&traces[i].reader, argv[i + 1]) != 0)
+      return -1;
+  }
+
+  uint64_t mask = config.dramSize != 0 ? config.dramSize - 1 : UINT64_MAX;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  if (Parts != NULL) {
+    /* every word goes to the thread owning its sets */
+    const TraceRecord *records;
+    size_t count;
+    while ((count = nextTraceRecords(&traces[0].reader, &records)) > 0) {
+      for (size_t r = 0; r < count; r++) {
+        uint32_t words = (records[r].size + WORD_SIZE - 1) / WORD_SIZE;
+        if (words == 0)
+          words = 1;
+        for (uint32_t w = 0; w < words; w++)
+          accessPartitions(Parts, (records[r].address + w * WORD_SIZE) & mask & ~(uint64_t)(WORD_SIZE - 1),
+                           records[r].mode);
+        accesses += words;
+      }
+    }
+    finishPartitions(Parts);
+  }
+  else if (period > 0) {
+    /* every word warmed, or simulated in a window */
+    const TraceRecord *records;
+    size_t count;
+    while ((count = nextTraceRecords(&traces[0].reader, &records)) > 0) {
+      for (size_t r = 0; r < count; r++) {
+        uint32_t words = (records[r].size + WORD_SIZE - 1) / WORD_SIZE;
+        if (words == 0)
+          words = 1;
+        for (uint32_t w = 0; w < words; w++) {
+          uint64_t address = (records[r].address + w * WORD_SIZE) & mask & ~(uint64_t)(WORD_SIZE - 1);
+          uint32_t value = (uint32_t)address;
+          sampleAccess(&Sampling, address, (uint8_t *)(&value), records[r].mode);
+        }
+        accesses += words;
+      }
+    }
+  }
+  else if (files == 1 && config.cores == 1 && !verbose) {
+    /* the common case: whole batches of words per call */
+    static Batch batch;
+    const TraceRecord *records;
+    size_t count;
+    while ((count = nextTraceRecords(&traces[0].reader, &records)) > 0) {
+      for (size_t r = 0; r < count; r++)
+        accesses += batchRecord(Sim, &batch, &records[r], mask);
+    }
+    flushBatch(Sim, &batch);
+  }
+  else if (files == 1) {
+    const TraceRecord *records;
+    size_t count;
+    while ((count = nextTraceRecords(&traces[0].reader, &records)) > 0) {
+      for (size_t r = 0; r < count; r++)
+        accesses += replayRecord(Sim, &records[r], records[r].core % config.cores, mask, verbose);
+    }
+  }
+  else {
+    uint32_t active = files;
+    while (active > 0) {
+      active = 0;
+      for (uint32_t core = 0; core < files; core++) {
+        CoreTrace *trace = &traces[core];
+        if (trace->done)
+          continue;
+        if (trace->next == trace->count) {
+          trace->count = nextTraceRecords(&trace->reader, &trace->records);
+          trace->next = 0;
+          if (trace->count == 0) {
+            closeTrace(&trace->reader);
+            trace->done = 1;
+            continue;
+          }
+        }
+        accesses += replayRecord(Sim, &trace->records[trace->next++], core, mask, verbose);
+        active++;
+      }
+    }
+  }
+
+  double seconds = elapsedSeconds(&start);
+  if (files == 1)
+    closeTrace(&traces[0].reader);
+
+  StatsReport Report = Parts != NULL ? getPartitionStats(Parts) : getSimulatorStats(Sim);
+  printf("Accesses: %llu\n", (unsigned long long)accesses);
+  printf("Time: %llu\n", (unsigned long long)Report.time);
+  if (config.timing == TIMING_EVENT)
+    printf("Cycles: %llu\n", (unsigned long long)Report.cycles);
+  printf("Host seconds: %.3f\n", seconds);
+  printf("Accesses/sec: %.0f\n", seconds > 0 ? accesses / seconds : 0.0);
+  if (period > 0)
+    printSampleReport(stdout, &Sampling);
+  if (Report.latency != NULL)
+    printLatencyReport(stdout, Report.latency);
+
+  int status = 0;
+  if (savePath != NULL)
+    status |= saveSimulator(Sim, savePath);
+  if (jsonPath != NULL)
+    status |= writeStats(&Report, jsonPath, STATS_JSON);
+  if (csvPath != NULL)
+    status |= writeStats(&Report, csvPath, STATS_CSV);
+  freeSimulator(Sim);
+  freePartitions(Parts);
+  return status;
+}
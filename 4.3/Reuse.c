@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Reuse.h"
+
+#define STACK_START 64          // positions per set to begin with
+#define HISTOGRAM_START 1024
+
+/*********************** Fenwick tree *************************/
+
+/* Marked positions in [0, position] */
+static uint64_t countUpTo(const StackSet *Stack, uint64_t position) {
+    uint64_t sum = 0;
+
+    for (uint64_t i = position + 1; i > 0; i -= i & (0 - i))
+        sum += Stack->tree[i];
+    return sum;
+}
+
+static void addAt(StackSet *Stack, uint64_t position, int32_t delta) {
+    for (uint64_t i = position + 1; i <= Stack->capacity; i += i & (0 - i))
+        Stack->tree[i] += (uint32_t)delta;
+}
+
+/* Packs the marked positions to the front, doubling the set when they
+   would fill more than half of it, and rebuilds the tree in O(n) */
+static int compactStack(StackSet *Stack, HashMap *Last) {
+    uint64_t next = 0;
+
+    for (uint64_t position = 0; position < Stack->clock; position++) {
+        if (Stack->owner[position] == REUSE_FREE)
+            continue;
+        Stack->owner[next] = Stack->owner[position];
+        *findHashMap(Last, Stack->owner[next]) = next;
+        next++;
+    }
+    if (next * 2 > Stack->capacity || Stack->tree == NULL) {
+        uint64_t capacity = Stack->capacity ? Stack->capacity * 2 : STACK_START;
+        uint64_t *owner = realloc(Stack->owner, capacity * sizeof(uint64_t));
+        if (owner == NULL)
+            return -1;
+        Stack->owner = owner;
+        uint32_t *tree = realloc(Stack->tree, (capacity + 1) * sizeof(uint32_t));
+        if (tree == NULL)
+            return -1;
+        Stack->tree = tree;
+        Stack->capacity = capacity;
+    }
+    Stack->clock = next;
+
+    memset(Stack->tree, 0, (Stack->capacity + 1) * sizeof(uint32_t));
+    for (uint64_t i = 1; i <= Stack->capacity; i++) {
+        Stack->tree[i] += i <= next;
+        uint64_t parent = i + (i & (0 - i));
+        if (parent <= Stack->capacity)
+            Stack->tree[parent] += Stack->tree[i];
+    }
+    return 0;
+}
+
+/*********************** Profiles *************************/
+
+/* sets must be a power of two, 1 for fully associative */
+int initReuseProfile(ReuseProfile *Profile, uint32_t sets, uint32_t blockSize) {
+    memset(Profile, 0, sizeof(*Profile));
+    if (sets == 0 || (sets & (sets - 1)) != 0 || blockSize == 0 || (blockSize & (blockSize - 1)) != 0)
+        return -1;
+    Profile->sets = sets;
+    Profile->offsetBits = (uint32_t)__builtin_ctz(blockSize);
+    Profile->stacks = calloc(sets, sizeof(StackSet));
+    Profile->histogram = calloc(HISTOGRAM_START, sizeof(uint64_t));
+    Profile->distances = HISTOGRAM_START;
+    if (Profile->stacks == NULL || Profile->histogram == NULL || initHashMap(&Profile->last, 1024) != 0) {
+        freeReuseProfile(Profile);
+        return -1;
+    }
+    return 0;
+}
+
+void freeReuseProfile(ReuseProfile *Profile) {
+    for (uint32_t set = 0; Profile->stacks != NULL && set < Profile->sets; set++) {
+        free(Profile->stacks[set].tree);
+        free(Profile->stacks[set].owner);
+    }
+    free(Profile->stacks);
+    free(Profile->histogram);
+    if (Profile->last.keys != NULL)
+        freeHashMap(&Profile->last);
+    memset(Profile, 0, sizeof(*Profile));
+}
+
+static int countDistance(ReuseProfile *Profile, uint64_t distance) {
+    if (distance >= Profile->distances) {
+        uint64_t distances = Profile->distances;
+        while (distances <= distance)
+            distances *= 2;
+        uint64_t *histogram = realloc(Profile->histogram, distances * sizeof(uint64_t));
+        if (histogram == NULL)
+            return -1;
+        memset(histogram + Profile->distances, 0, (distances - Profile->distances) * sizeof(uint64_t));
+        Profile->histogram = histogram;
+        Profile->distances = distances;
+    }
+    Profile->histogram[distance]++;
+    return 0;
+}
+
+/* One access to the block holding address, -1 when out of memory */
+int profileAccess(ReuseProfile *Profile, uint64_t address) {
+    uint64_t block = address >> Profile->offsetBits;
+    StackSet *Stack = &Profile->stacks[block & (Profile->sets - 1)];
+    int inserted;
+
+    if (Stack->clock == Stack->capacity && compactStack(Stack, &Profile->last) != 0)
+        return -1;
+    uint64_t *Last = insertHashMap(&Profile->last, block, &inserted);
+    if (Last == NULL)
+        return -1;
+
+    Profile->accesses++;
+    if (inserted) {
+        Profile->cold++;
+        Stack->live++;
+    } else {
+        uint64_t distance = Stack->live - countUpTo(Stack, *Last);
+        if (countDistance(Profile, distance) != 0)
+            return -1;
+        Stack->owner[*Last] = REUSE_FREE;
+        addAt(Stack, *Last, -1);
+    }
+    *Last = Stack->clock;
+    Stack->owner[Stack->clock] = block;
+    addAt(Stack, Stack->clock, 1);
+    Stack->clock++;
+    return 0;
+}
+
+/* Largest distance seen plus one: the ways from which only cold misses are left */
+uint64_t getMaxDistance(const ReuseProfile *Profile) {
+    uint64_t distance = Profile->distances;
+
+    while (distance > 0 && Profile->histogram[distance - 1] == 0)
+        distance--;
+    return distance;
+}
+
+/* Misses of an LRU cache with the profile's sets and ways ways per set */
+uint64_t getReuseMisses(const ReuseProfile *Profile, uint64_t ways) {
+    uint64_t misses = Profile->cold;
+
+    for (uint64_t distance = ways; distance < Profile->distances; distance++)
+        misses += Profile->histogram[distance];
+    return misses;
+}
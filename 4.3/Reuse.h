@@ -0,0 +1,51 @@
+#ifndef REUSE_H
+#define REUSE_H
+
+#include <stdint.h>
+#include "HashMap.h"
+
+/* LRU stack distance profiling (Mattson et al.): one pass over a trace
+   gives the miss count of an LRU cache of every associativity at once.
+   The distance of an access is the number of other blocks of its set
+   touched since the last access to the same block, and an LRU set of w
+   ways hits exactly the accesses at a distance below w. With one set this
+   covers every fully associative capacity.
+
+   Each set numbers its accesses on a clock of its own. A Fenwick tree
+   marks the positions that are still some block's latest access, so a
+   distance is one prefix sum and an access costs O(log n). When the clock
+   reaches the end, the marked positions are packed to the front (and the
+   set grows if they fill more than half of it). */
+
+#define REUSE_FREE UINT64_MAX
+
+typedef struct StackSet {
+  uint64_t clock;         // next position
+  uint64_t live;          // marked positions: distinct blocks seen so far
+  uint64_t capacity;
+  uint32_t *tree;         // Fenwick tree over positions, 1 based
+  uint64_t *owner;        // block whose access a position is, REUSE_FREE once reused
+} StackSet;
+
+typedef struct ReuseProfile {
+  uint32_t sets;          // a power of two, sets are picked like getIndex
+  uint32_t offsetBits;
+  StackSet *stacks;
+  HashMap last;           // block number -> its latest position in its set
+  uint64_t *histogram;    // accesses per distance
+  uint64_t distances;     // histogram entries allocated
+  uint64_t cold;          // first accesses to a block, misses at any size
+  uint64_t accesses;
+} ReuseProfile;
+
+int initReuseProfile(ReuseProfile *, uint32_t, uint32_t);
+
+void freeReuseProfile(ReuseProfile *);
+
+int profileAccess(ReuseProfile *, uint64_t);
+
+uint64_t getMaxDistance(const ReuseProfile *);
+
+uint64_t getReuseMisses(const ReuseProfile *, uint64_t);
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include "4.3Cache.h"
+#include "Reuse.h"
+#include "../trace/Trace.h"
+
+/*
+ * Prints the miss ratio curve of a trace in one pass (see Reuse.h): the
+ * misses of an LRU cache at every power of two associativity, for a fully
+ * associative cache and for each set count given with -S (by default the
+ * set counts of the configured L1 and L2). Addresses are folded and split
+ * into words as in Replay, so a row matches the L1 of a Replay run with
+ * that geometry and l1_replacement=lru.
+ *
+ *   -c <file>, -s name=value   as in Replay, block_size and dram_size are used
+ *   -S <sets>                  add a set count, a power of two
+ *
+ * Output is CSV: sets,ways,size,misses,miss_ratio with size in bytes.
+ */
+
+#define MAX_PROFILES 16
+
+static uint32_t getSets(const CacheConfig *config, const LevelConfig *level) {
+  if (level->ways == 0 || level->size == 0)
+    return 0;
+  return level->size / (config->blockSize * level->ways);
+}
+
+/* Adds a profile unless one with that set count exists */
+static int addProfile(ReuseProfile *profiles, uint32_t *count, uint32_t sets, uint32_t blockSize) {
+  for (uint32_t p = 0; p < *count; p++) {
+    if (profiles[p].sets == sets)
+      return 0;
+  }
+  if (*count == MAX_PROFILES || initReuseProfile(&profiles[*count], sets, blockSize) != 0) {
+    fprintf(stderr, "Reuse: can not profile %u sets\n", sets);
+    return -1;
+  }
+  (*count)++;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+
+  ReuseProfile profiles[MAX_PROFILES];
+  uint32_t count = 0, requested[MAX_PROFILES], nrequested = 0;
+  CacheConfig config = getDefaultConfig();
+  TraceReader reader;
+
+  while (argc > 2 && argv[1][0] == '-' && argv[1][1] != '\0') {
+    if (strcmp(argv[1], "-c") == 0 && loadConfigFile(&config, argv[2]) == 0) {
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-s") == 0 && parseConfigOption(&config, argv[2]) == 0) {
+      argc -= 2;
+      argv += 2;
+    }
+    else if (strcmp(argv[1], "-S") == 0 && nrequested < MAX_PROFILES) {
+      requested[nrequested++] = (uint32_t)strtoul(argv[2], NULL, 0);
+      argc -= 2;
+      argv += 2;
+    }
+    else {
+      break;
+    }
+  }
+  if (argc != 2) {
+    fprintf(stderr, "usage: Reuse [-c config] [-s name=value]... [-S sets]... <trace file | ->\n");
+    return -1;
+  }
+
+  int status = addProfile(profiles, &count, 1, config.blockSize);
+  if (nrequested == 0) {
+    requested[nrequested++] = getSets(&config, &config.L1);
+    requested[nrequested++] = getSets(&config, &config.L2);
+  }
+  for (uint32_t r = 0; r < nrequested && status == 0; r++) {
+    if (requested[r] != 0)
+      status = addProfile(profiles, &count, requested[r], config.blockSize);
+  }
+  if (status != 0 || openTrace(&reader, argv[1]) != 0)
+    return -1;
+
+  uint64_t mask = config.dramSize != 0 ? config.dramSize - 1 : UINT64_MAX;
+  const TraceRecord *records;
+  size_t n;
+  while (status == 0 && (n = nextTraceRecords(&reader, &records)) > 0) {
+    for (size_t r = 0; r < n && status == 0; r++) {
+      uint32_t words = (records[r].size + WORD_SIZE - 1) / WORD_SIZE;
+      if (words == 0)
+        words = 1;
+      for (uint32_t w = 0; w < words; w++) {
+        uint64_t address = (records[r].address + w * WORD_SIZE) & mask & ~(uint64_t)(WORD_SIZE - 1);
+        for (uint32_t p = 0; p < count; p++)
+          status |= profileAccess(&profiles[p], address);
+      }
+    }
+  }
+  closeTrace(&reader);
+  if (status != 0) {
+    fprintf(stderr, "Reuse: out of memory\n");
+    return -1;
+  }
+
+  printf("sets,ways,size,misses,miss_ratio\n");
+  for (uint32_t p = 0; p < count; p++) {
+    ReuseProfile *Profile = &profiles[p];
+    uint64_t last = getMaxDistance(Profile);
+    for (uint64_t ways = 1;; ways *= 2) {
+      uint64_t misses = getReuseMisses(Profile, ways);
+      printf("%u,%llu,%llu,%llu,%.6f\n", Profile->sets, (unsigned long long)ways,
+             (unsigned long long)(ways * Profile->sets * config.blockSize), (unsigned long long)misses,
+             Profile->accesses ? (double)misses / Profile->accesses : 0.0);
+      if (ways >= last)
+        break;
+    }
+    freeReuseProfile(Profile);
+  }
+  return 0;
+}
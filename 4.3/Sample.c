@@ -0,0 +1,117 @@
+#include <math.h>
+#include "Sample.h"
+
+static const LevelStats *getSampleLevel(const Sampler *Sampling, uint32_t level) {
+    return level == 0 ? &Sampling->sim->L1[0].stats : &Sampling->sim->L2.stats;
+}
+
+static uint64_t countAccesses(const LevelStats *Stats) {
+    return Stats->hits[MODE_READ] + Stats->hits[MODE_WRITE] + Stats->misses[MODE_READ] + Stats->misses[MODE_WRITE];
+}
+
+static void addSample(SampleSums *Sums, double x, double y) {
+    Sums->x += x;
+    Sums->y += y;
+    Sums->xx += x * x;
+    Sums->yy += y * y;
+    Sums->xy += x * y;
+}
+
+/* Ratio estimate sum(y) / sum(x) over n windows and its confidence interval */
+static SampleEstimate estimateRatio(const SampleSums *Sums, uint64_t n) {
+    SampleEstimate Estimate = { 0.0, 0.0 };
+
+    if (n == 0 || Sums->x <= 0)
+        return Estimate;
+    double ratio = Sums->y / Sums->x;
+    Estimate.value = ratio;
+    if (n < 2)
+        return Estimate;
+    double spread = (Sums->yy - 2 * ratio * Sums->xy + ratio * ratio * Sums->xx) / (n - 1);
+    double mean = Sums->x / n;
+    Estimate.halfWidth = spread > 0 ? SAMPLE_Z * sqrt(spread / n) / mean : 0.0;
+    return Estimate;
+}
+
+/* period accesses per sample, the last window measured after warmup in detail */
+int initSampler(Sampler *Sampling, Simulator *Sim, uint64_t period, uint64_t warmup, uint64_t window) {
+    const CacheConfig *config = &Sim->config;
+
+    memset(Sampling, 0, sizeof(*Sampling));
+    if (window == 0 || warmup + window > period) {
+        fprintf(stderr, "initSampler: needs 0 < warmup + window <= period\n");
+        return -1;
+    }
+    if (config->cores != 1 || !config->tagOnly || config->timing != TIMING_ADDITIVE || config->classifyMisses ||
+        config->inclusion == INCLUSION_EXCLUSIVE || config->L1.prefetcher != PREFETCH_NONE ||
+        config->L2.prefetcher != PREFETCH_NONE || config->L1.victimEntries || config->L2.victimEntries) {
+        fprintf(stderr, "initSampler: needs one core, tag_only=1, additive timing and no prefetchers, "
+                "victim caches, exclusive L2 or miss classification\n");
+        return -1;
+    }
+    Sampling->sim = Sim;
+    Sampling->period = period;
+    Sampling->warmup = warmup;
+    Sampling->window = window;
+    Sampling->levels = config->levels;
+    return 0;
+}
+
+/* One word access from the CPU, warmed or simulated by where it falls in its period */
+void sampleAccess(Sampler *Sampling, uint64_t address, uint8_t *data, uint32_t mode) {
+    uint64_t detailed = Sampling->period - Sampling->warmup - Sampling->window;
+    uint64_t measured = Sampling->period - Sampling->window;
+
+    if (Sampling->position < detailed) {
+        warmSimulator(Sampling->sim, address, mode);
+    } else {
+        if (Sampling->position == measured) {             // a window opens
+            Sampling->startTime = getSimulatorTime(Sampling->sim);
+            for (uint32_t l = 0; l < Sampling->levels; l++) {
+                const LevelStats *Stats = getSampleLevel(Sampling, l);
+                Sampling->startAccesses[l] = countAccesses(Stats);
+                Sampling->startMisses[l] = Stats->misses[MODE_READ] + Stats->misses[MODE_WRITE];
+            }
+        }
+        accessSimulator(Sampling->sim, address, data, mode);
+    }
+    Sampling->accesses++;
+    if (++Sampling->position < Sampling->period)
+        return;
+
+    Sampling->position = 0;                               // the window closes
+    Sampling->windows++;
+    addSample(&Sampling->time, (double)Sampling->window, (double)(getSimulatorTime(Sampling->sim) - Sampling->startTime));
+    for (uint32_t l = 0; l < Sampling->levels; l++) {
+        const LevelStats *Stats = getSampleLevel(Sampling, l);
+        addSample(&Sampling->misses[l], (double)(countAccesses(Stats) - Sampling->startAccesses[l]),
+                  (double)(Stats->misses[MODE_READ] + Stats->misses[MODE_WRITE] - Sampling->startMisses[l]));
+    }
+}
+
+/* Time per access */
+SampleEstimate getSampleTime(const Sampler *Sampling) {
+    return estimateRatio(&Sampling->time, Sampling->windows);
+}
+
+/* Misses per access of level 0 (the L1) or 1 (the L2) */
+SampleEstimate getSampleMissRate(const Sampler *Sampling, uint32_t level) {
+    SampleEstimate None = { 0.0, 0.0 };
+
+    return level < Sampling->levels ? estimateRatio(&Sampling->misses[level], Sampling->windows) : None;
+}
+
+void printSampleReport(FILE *out, const Sampler *Sampling) {
+    SampleEstimate Time = getSampleTime(Sampling);
+    static const char *Names[MAX_SAMPLE_LEVELS] = { "L1", "L2" };
+
+    fprintf(out, "Sampled windows: %llu of %llu accesses each, over %llu accesses\n",
+            (unsigned long long)Sampling->windows, (unsigned long long)Sampling->window,
+            (unsigned long long)Sampling->accesses);
+    fprintf(out, "Estimated time: %.0f +- %.0f\n", Time.value * Sampling->accesses, Time.halfWidth * Sampling->accesses);
+    fprintf(out, "Estimated time per access: %.4f +- %.4f\n", Time.value, Time.halfWidth);
+    for (uint32_t l = 0; l < Sampling->levels; l++) {
+        SampleEstimate Rate = getSampleMissRate(Sampling, l);
+        fprintf(out, "Estimated %s miss rate: %.6f +- %.6f\n", Names[l], Rate.value, Rate.halfWidth);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include "4.3Cache.h"
+
+/* Sampled simulation in the style of SMARTS (Wunderlich et al.). Every
+   period accesses, the first period - warmup - window only warm the tags
+   (warmSimulator), the next warmup run in detail without being measured,
+   and the last window run in detail and are measured. Each window is one
+   sample of the time per access and of every level's misses per access
+   to it; the totals are ratio estimates over the windows, with a normal
+   confidence interval. The time of the whole run is the time per access
+   times the access count.
+
+   Warming covers one core over a non-inclusive or inclusive L2 without prefetchers
+   or victim caches, in tag only mode with additive timing. */
+
+#define SAMPLE_Z 1.96               // 95% confidence
+#define MAX_SAMPLE_LEVELS 2         // the L1 and the L2
+
+/* Sums over the windows of one ratio y / x */
+typedef struct SampleSums {
+  double x;
+  double y;
+  double xx;
+  double yy;
+  double xy;
+} SampleSums;
+
+typedef struct Sampler {
+  Simulator *sim;
+  uint64_t period;
+  uint64_t warmup;
+  uint64_t window;
+  uint64_t position;        // in the current period
+  uint64_t accesses;
+  uint64_t windows;         // measured so far
+  uint32_t levels;
+  uint64_t startTime;       // at the start of the open window
+  uint64_t startAccesses[MAX_SAMPLE_LEVELS];
+  uint64_t startMisses[MAX_SAMPLE_LEVELS];
+  SampleSums time;          // x accesses, y time
+  SampleSums misses[MAX_SAMPLE_LEVELS];   // x accesses to the level, y its misses
+} Sampler;
+
+typedef struct SampleEstimate {
+  double value;
+  double halfWidth;         // of the confidence interval, 0 with fewer than two windows
+} SampleEstimate;
+
+int initSampler(Sampler *, Simulator *, uint64_t, uint64_t, uint64_t);
+
+void sampleAccess(Sampler *, uint64_t, uint8_t *, uint32_t);
+
+SampleEstimate getSampleTime(const Sampler *);
+
+SampleEstimate getSampleMissRate(const Sampler *, uint32_t);
+
+void printSampleReport(FILE *, const Sampler *);
+
+#endif
@@ -0,0 +1,450 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Cache.h"
+#include "Stats.h"
+
+#define NO_NODE UINT32_MAX
+
+/*********************** Miss classification *************************/
+
+MissClassifier *createClassifier(uint32_t capacity) {
+    MissClassifier *Classifier = calloc(1, sizeof(MissClassifier));
+
+    if (Classifier == NULL)
+        return NULL;
+    Classifier->capacity = capacity;
+    Classifier->block = malloc(capacity * sizeof(uint64_t));
+    Classifier->prev = malloc(capacity * sizeof(uint32_t));
+    Classifier->next = malloc(capacity * sizeof(uint32_t));
+    if (Classifier->block == NULL || Classifier->prev == NULL || Classifier->next == NULL ||
+        initHashMap(&Classifier->seen, 4 * (uint64_t)capacity) != 0 ||
+        initHashMap(&Classifier->present, 2 * (uint64_t)capacity) != 0) {
+        freeClassifier(Classifier);
+        return NULL;
+    }
+    resetClassifier(Classifier);
+    return Classifier;
+}
+
+void resetClassifier(MissClassifier *Classifier) {
+    clearHashMap(&Classifier->seen);
+    clearHashMap(&Classifier->present);
+    Classifier->count = 0;
+    Classifier->head = NO_NODE;
+    Classifier->tail = NO_NODE;
+}
+
+void freeClassifier(MissClassifier *Classifier) {
+    if (Classifier == NULL)
+        return;
+    freeHashMap(&Classifier->seen);
+    freeHashMap(&Classifier->present);
+    free(Classifier->block);
+    free(Classifier->prev);
+    free(Classifier->next);
+    free(Classifier);
+}
+
+static void unlinkNode(MissClassifier *Classifier, uint32_t node) {
+    if (Classifier->prev[node] != NO_NODE)
+        Classifier->next[Classifier->prev[node]] = Classifier->next[node];
+    else
+        Classifier->head = Classifier->next[node];
+    if (Classifier->next[node] != NO_NODE)
+        Classifier->prev[Classifier->next[node]] = Classifier->prev[node];
+    else
+        Classifier->tail = Classifier->prev[node];
+}
+
+static void pushFront(MissClassifier *Classifier, uint32_t node) {
+    Classifier->prev[node] = NO_NODE;
+    Classifier->next[node] = Classifier->head;
+    if (Classifier->head != NO_NODE)
+        Classifier->prev[Classifier->head] = node;
+    else
+        Classifier->tail = node;
+    Classifier->head = node;
+}
+
+/* Runs block through the shadow fully associative LRU cache and, if the
+   real level missed, charges the miss to one of the three classes.
+   Returns -1 if the tables could not grow. */
+int classifyAccess(MissClassifier *Classifier, uint64_t block, uint32_t miss, LevelStats *Stats) {
+    uint64_t *Node = findHashMap(&Classifier->present, block);
+    uint32_t shadowHit = Node != NULL;
+    uint32_t node;
+    int firstTime;
+
+    if (shadowHit) {
+        node = (uint32_t)*Node;
+        unlinkNode(Classifier, node);
+    } else {
+        if (Classifier->count == Classifier->capacity) {
+            node = Classifier->tail;                    // reuse the LRU node
+            unlinkNode(Classifier, node);
+            removeHashMap(&Classifier->present, Classifier->block[node]);
+        } else {
+            node = Classifier->count++;
+        }
+        Node = insertHashMap(&Classifier->present, block, &firstTime);
+        if (Node == NULL)
+            return -1;
+        *Node = node;
+        Classifier->block[node] = block;
+    }
+    pushFront(Classifier, node);
+
+    if (insertHashMap(&Classifier->seen, block, &firstTime) == NULL)
+        return -1;
+    if (miss) {
+        if (firstTime)
+            Stats->compulsory++;
+        else if (!shadowHit)
+            Stats->capacity++;
+        else
+            Stats->conflict++;
+    }
+    return 0;
+}
+
+/*********************** Reports *************************/
+
+static uint64_t getAccesses(const LevelStats *Stats) {
+    return Stats->hits[0] + Stats->hits[1] + Stats->misses[0] + Stats->misses[1];
+}
+
+static double getMissRate(const LevelStats *Stats) {
+    uint64_t accesses = getAccesses(Stats);
+    return accesses ? (double)(Stats->misses[0] + Stats->misses[1]) / accesses : 0.0;
+}
+
+static double getRatio(uint64_t part, uint64_t whole) {
+    return whole ? (double)part / whole : 0.0;
+}
+
+/* Adds every counter of Stats to Total */
+void addLevelStats(LevelStats *Total, const LevelStats *Stats) {
+    for (int mode = 0; mode < 2; mode++) {
+        Total->hits[mode] += Stats->hits[mode];
+        Total->misses[mode] += Stats->misses[mode];
+    }
+    Total->compulsory += Stats->compulsory;
+    Total->capacity += Stats->capacity;
+    Total->conflict += Stats->conflict;
+    Total->evictions += Stats->evictions;
+    Total->dirtyEvictions += Stats->dirtyEvictions;
+    Total->prefetches += Stats->prefetches;
+    Total->prefetchHits += Stats->prefetchHits;
+    Total->prefetchLate += Stats->prefetchLate;
+    Total->prefetchUseless += Stats->prefetchUseless;
+    Total->victimHits += Stats->victimHits;
+    Total->bufferedWrites += Stats->bufferedWrites;
+    Total->bufferStalls += Stats->bufferStalls;
+    Total->writeThroughs += Stats->writeThroughs;
+    Total->writeArounds += Stats->writeArounds;
+    Total->traffic[0] += Stats->traffic[0];
+    Total->traffic[1] += Stats->traffic[1];
+    Total->backInvalidations += Stats->backInvalidations;
+    Total->mshrMerges += Stats->mshrMerges;
+    Total->mshrStalls += Stats->mshrStalls;
+}
+
+void addDRAMStats(DRAMStats *Total, const DRAMStats *Stats) {
+    for (int mode = 0; mode < 2; mode++) {
+        Total->accesses[mode] += Stats->accesses[mode];
+        Total->bytes[mode] += Stats->bytes[mode];
+    }
+}
+
+/*********************** Latency histograms *************************/
+
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_HALF_BUCKETS (1 << (LATENCY_SUB_BITS - 1))
+
+static const char *LatencyClassNames[NUM_LATENCY_CLASSES] = { "L1_hit", "L2_hit", "DRAM", "write_back" };
+
+/* Values under LATENCY_SUB_BUCKETS have their own bucket, larger ones
+   keep their top LATENCY_SUB_BITS bits */
+static uint32_t getLatencyBucket(uint64_t value) {
+    if (value < LATENCY_SUB_BUCKETS)
+        return (uint32_t)value;
+    uint32_t shift = 63 - (uint32_t)__builtin_clzll(value) - (LATENCY_SUB_BITS - 1);
+    return LATENCY_SUB_BUCKETS + (shift - 1) * LATENCY_HALF_BUCKETS + (uint32_t)(value >> shift) - LATENCY_HALF_BUCKETS;
+}
+
+/* The largest value that lands in bucket */
+static uint64_t getBucketTop(uint32_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS)
+        return bucket;
+    uint32_t shift = (bucket - LATENCY_SUB_BUCKETS) / LATENCY_HALF_BUCKETS + 1;
+    uint64_t top = LATENCY_HALF_BUCKETS + (bucket - LATENCY_SUB_BUCKETS) % LATENCY_HALF_BUCKETS;
+    return (top << shift) + ((uint64_t)1 << shift) - 1;
+}
+
+void recordLatency(LatencyHistogram *Histogram, uint64_t latency) {
+    Histogram->counts[getLatencyBucket(latency)]++;
+    Histogram->count++;
+    if (latency > Histogram->max)
+        Histogram->max = latency;
+}
+
+/* The smallest value at or above percent of the recorded ones, to the
+   bucket resolution and never past the largest seen, 0 if empty */
+uint64_t getLatencyPercentile(const LatencyHistogram *Histogram, double percent) {
+    double exact = percent / 100.0 * Histogram->count;
+    uint64_t rank = (uint64_t)exact;
+    uint64_t seen = 0;
+
+    if (Histogram->count == 0)
+        return 0;
+    if (rank < exact || rank == 0)
+        rank++;
+    for (uint32_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += Histogram->counts[bucket];
+        if (seen >= rank) {
+            uint64_t top = getBucketTop(bucket);
+            return top < Histogram->max ? top : Histogram->max;
+        }
+    }
+    return Histogram->max;
+}
+
+void addLatencyHistogram(LatencyHistogram *Total, const LatencyHistogram *Histogram) {
+    for (uint32_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+        Total->counts[bucket] += Histogram->counts[bucket];
+    Total->count += Histogram->count;
+    if (Histogram->max > Total->max)
+        Total->max = Histogram->max;
+}
+
+void addLatencyStats(LatencyStats *Total, const LatencyStats *Stats) {
+    for (uint32_t c = 0; c < NUM_LATENCY_CLASSES; c++)
+        for (int mode = 0; mode < 2; mode++)
+            addLatencyHistogram(&Total->classes[c][mode], &Stats->classes[c][mode]);
+}
+
+const char *getLatencyClassName(uint32_t latencyClass) {
+    return latencyClass < NUM_LATENCY_CLASSES ? LatencyClassNames[latencyClass] : "unknown";
+}
+
+/* Every class of one mode together */
+static void getModeLatency(LatencyHistogram *Total, const LatencyStats *Stats, int mode) {
+    memset(Total, 0, sizeof(*Total));
+    for (uint32_t c = 0; c < NUM_LATENCY_CLASSES; c++)
+        addLatencyHistogram(Total, &Stats->classes[c][mode]);
+}
+
+/* Sum of the private L1s, what the cores as a whole saw */
+static LevelStats getFirstLevel(const StatsReport *Report) {
+    LevelStats Total;
+    uint32_t cores = Report->cores ? Report->cores : 1;
+
+    memset(&Total, 0, sizeof(Total));
+    for (uint32_t i = 0; i < cores; i++)
+        addLevelStats(&Total, Report->levels[i]);
+    return Total;
+}
+
+/* Average memory access time, in cycles per access seen by the first level */
+static double getAMAT(const StatsReport *Report) {
+    LevelStats First = getFirstLevel(Report);
+    uint64_t accesses = getAccesses(&First);
+    return accesses ? (double)Report->time / accesses : 0.0;
+}
+
+static void printLevelJSON(FILE *out, const char *name, const LevelStats *Stats) {
+    fprintf(out, "  \"%s\": {\n", name);
+    fprintf(out, "    \"read_hits\": %llu,\n", (unsigned long long)Stats->hits[MODE_READ]);
+    fprintf(out, "    \"read_misses\": %llu,\n", (unsigned long long)Stats->misses[MODE_READ]);
+    fprintf(out, "    \"write_hits\": %llu,\n", (unsigned long long)Stats->hits[MODE_WRITE]);
+    fprintf(out, "    \"write_misses\": %llu,\n", (unsigned long long)Stats->misses[MODE_WRITE]);
+    fprintf(out, "    \"miss_rate\": %.6f,\n", getMissRate(Stats));
+    fprintf(out, "    \"compulsory\": %llu,\n", (unsigned long long)Stats->compulsory);
+    fprintf(out, "    \"capacity\": %llu,\n", (unsigned long long)Stats->capacity);
+    fprintf(out, "    \"conflict\": %llu,\n", (unsigned long long)Stats->conflict);
+    fprintf(out, "    \"evictions\": %llu,\n", (unsigned long long)Stats->evictions);
+    fprintf(out, "    \"dirty_evictions\": %llu,\n", (unsigned long long)Stats->dirtyEvictions);
+    fprintf(out, "    \"read_traffic_bytes\": %llu,\n", (unsigned long long)Stats->traffic[MODE_READ]);
+    fprintf(out, "    \"write_traffic_bytes\": %llu", (unsigned long long)Stats->traffic[MODE_WRITE]);
+    if (Stats->writeThroughs || Stats->writeArounds) {
+        fprintf(out, ",\n    \"write_throughs\": %llu,\n", (unsigned long long)Stats->writeThroughs);
+        fprintf(out, "    \"write_arounds\": %llu", (unsigned long long)Stats->writeArounds);
+    }
+    if (Stats->backInvalidations)
+        fprintf(out, ",\n    \"back_invalidations\": %llu", (unsigned long long)Stats->backInvalidations);
+    if (Stats->mshrMerges || Stats->mshrStalls) {
+        fprintf(out, ",\n    \"mshr_merges\": %llu,\n", (unsigned long long)Stats->mshrMerges);
+        fprintf(out, "    \"mshr_stalls\": %llu", (unsigned long long)Stats->mshrStalls);
+    }
+    if (Stats->victimHits || Stats->bufferedWrites) {
+        fprintf(out, ",\n    \"victim_hits\": %llu,\n", (unsigned long long)Stats->victimHits);
+        fprintf(out, "    \"buffered_writes\": %llu,\n", (unsigned long long)Stats->bufferedWrites);
+        fprintf(out, "    \"buffer_stalls\": %llu", (unsigned long long)Stats->bufferStalls);
+    }
+    fprintf(out, "%s\n", Stats->prefetches ? "," : "");
+    if (Stats->prefetches) {
+        /* accuracy: prefetches used, coverage: misses removed, timeliness: used in time */
+        uint64_t misses = Stats->misses[MODE_READ] + Stats->misses[MODE_WRITE];
+        fprintf(out, "    \"prefetches\": %llu,\n", (unsigned long long)Stats->prefetches);
+        fprintf(out, "    \"prefetch_hits\": %llu,\n", (unsigned long long)Stats->prefetchHits);
+        fprintf(out, "    \"prefetch_late\": %llu,\n", (unsigned long long)Stats->prefetchLate);
+        fprintf(out, "    \"prefetch_useless\": %llu,\n", (unsigned long long)Stats->prefetchUseless);
+        fprintf(out, "    \"accuracy\": %.6f,\n", getRatio(Stats->prefetchHits, Stats->prefetches));
+        fprintf(out, "    \"coverage\": %.6f,\n", getRatio(Stats->prefetchHits, Stats->prefetchHits + misses));
+        fprintf(out, "    \"timeliness\": %.6f\n", getRatio(Stats->prefetchHits - Stats->prefetchLate, Stats->prefetchHits));
+    }
+    fprintf(out, "  },\n");
+}
+
+static void printLevelCSV(FILE *out, const LevelStats *Stats) {
+    fprintf(out, ",%llu,%llu,%llu,%llu,%.6f",
+            (unsigned long long)Stats->hits[MODE_READ], (unsigned long long)Stats->misses[MODE_READ],
+            (unsigned long long)Stats->hits[MODE_WRITE], (unsigned long long)Stats->misses[MODE_WRITE],
+            getMissRate(Stats));
+    fprintf(out, ",%llu,%llu,%llu,%llu,%llu",
+            (unsigned long long)Stats->compulsory, (unsigned long long)Stats->capacity,
+            (unsigned long long)Stats->conflict, (unsigned long long)Stats->evictions,
+            (unsigned long long)Stats->dirtyEvictions);
+    fprintf(out, ",%llu,%llu,%llu,%llu",
+            (unsigned long long)Stats->prefetches, (unsigned long long)Stats->prefetchHits,
+            (unsigned long long)Stats->prefetchLate, (unsigned long long)Stats->prefetchUseless);
+    fprintf(out, ",%llu,%llu,%llu", (unsigned long long)Stats->victimHits,
+            (unsigned long long)Stats->bufferedWrites, (unsigned long long)Stats->bufferStalls);
+    fprintf(out, ",%llu,%llu,%llu,%llu", (unsigned long long)Stats->writeThroughs, (unsigned long long)Stats->writeArounds,
+            (unsigned long long)Stats->traffic[MODE_READ], (unsigned long long)Stats->traffic[MODE_WRITE]);
+    fprintf(out, ",%llu,%llu,%llu", (unsigned long long)Stats->backInvalidations,
+            (unsigned long long)Stats->mshrMerges, (unsigned long long)Stats->mshrStalls);
+}
+
+static void printHistogramJSON(FILE *out, const char *mode, const LatencyHistogram *Histogram, const char *end) {
+    fprintf(out, "      \"%s\": { \"count\": %llu, \"p50\": %llu, \"p99\": %llu, \"p99.9\": %llu, \"max\": %llu }%s\n",
+            mode, (unsigned long long)Histogram->count,
+            (unsigned long long)getLatencyPercentile(Histogram, 50.0),
+            (unsigned long long)getLatencyPercentile(Histogram, 99.0),
+            (unsigned long long)getLatencyPercentile(Histogram, 99.9), (unsigned long long)Histogram->max, end);
+}
+
+static void printLatencyJSON(FILE *out, const LatencyStats *Stats) {
+    LatencyHistogram Reads, Writes;
+
+    fprintf(out, "  \"latency\": {\n");
+    for (uint32_t c = 0; c < NUM_LATENCY_CLASSES; c++) {
+        fprintf(out, "    \"%s\": {\n", LatencyClassNames[c]);
+        printHistogramJSON(out, "read", &Stats->classes[c][MODE_READ], ",");
+        printHistogramJSON(out, "write", &Stats->classes[c][MODE_WRITE], "");
+        fprintf(out, "    },\n");
+    }
+    getModeLatency(&Reads, Stats, MODE_READ);
+    getModeLatency(&Writes, Stats, MODE_WRITE);
+    fprintf(out, "    \"all\": {\n");
+    printHistogramJSON(out, "read", &Reads, ",");
+    printHistogramJSON(out, "write", &Writes, "");
+    fprintf(out, "    }\n");
+    fprintf(out, "  },\n");
+}
+
+void printStatsJSON(FILE *out, const StatsReport *Report) {
+    LevelStats First = getFirstLevel(Report);
+    const CoherenceStats *Bus = Report->coherence;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"time\": %llu,\n", (unsigned long long)Report->time);
+    if (Report->cycles)
+        fprintf(out, "  \"cycles\": %llu,\n", (unsigned long long)Report->cycles);
+    fprintf(out, "  \"accesses\": %llu,\n", (unsigned long long)getAccesses(&First));
+    fprintf(out, "  \"amat\": %.4f,\n", getAMAT(Report));
+    for (int i = 0; Report->names[i] != NULL; i++)
+        printLevelJSON(out, Report->names[i], Report->levels[i]);
+    if (Bus != NULL) {
+        fprintf(out, "  \"coherence\": {\n");
+        fprintf(out, "    \"bus_reads\": %llu,\n", (unsigned long long)Bus->busReads);
+        fprintf(out, "    \"bus_reads_exclusive\": %llu,\n", (unsigned long long)Bus->busReadsX);
+        fprintf(out, "    \"upgrades\": %llu,\n", (unsigned long long)Bus->upgrades);
+        fprintf(out, "    \"invalidations\": %llu,\n", (unsigned long long)Bus->invalidations);
+        fprintf(out, "    \"transfers\": %llu,\n", (unsigned long long)Bus->transfers);
+        fprintf(out, "    \"flushes\": %llu\n", (unsigned long long)Bus->flushes);
+        fprintf(out, "  },\n");
+    }
+    if (Report->latency != NULL)
+        printLatencyJSON(out, Report->latency);
+    fprintf(out, "  \"DRAM\": {\n");
+    fprintf(out, "    \"reads\": %llu,\n", (unsigned long long)Report->dram->accesses[MODE_READ]);
+    fprintf(out, "    \"writes\": %llu,\n", (unsigned long long)Report->dram->accesses[MODE_WRITE]);
+    fprintf(out, "    \"read_bytes\": %llu,\n", (unsigned long long)Report->dram->bytes[MODE_READ]);
+    fprintf(out, "    \"write_bytes\": %llu\n", (unsigned long long)Report->dram->bytes[MODE_WRITE]);
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+}
+
+static void printLevelCSVHeader(FILE *out, const char *name) {
+    fprintf(out, ",%s_read_hits,%s_read_misses,%s_write_hits,%s_write_misses,%s_miss_rate", name, name, name, name, name);
+    fprintf(out, ",%s_compulsory,%s_capacity,%s_conflict,%s_evictions,%s_dirty_evictions", name, name, name, name, name);
+    fprintf(out, ",%s_prefetches,%s_prefetch_hits,%s_prefetch_late,%s_prefetch_useless", name, name, name, name);
+    fprintf(out, ",%s_victim_hits,%s_buffered_writes,%s_buffer_stalls", name, name, name);
+    fprintf(out, ",%s_write_throughs,%s_write_arounds,%s_read_traffic_bytes,%s_write_traffic_bytes", name, name, name, name);
+    fprintf(out, ",%s_back_invalidations,%s_mshr_merges,%s_mshr_stalls", name, name, name);
+}
+
+void printStatsCSVHeader(FILE *out, const StatsReport *Report) {
+    uint32_t cores = Report->cores ? Report->cores : 1;
+
+    fprintf(out, "time,cycles,accesses,amat");
+    printLevelCSVHeader(out, "L1");
+    for (int i = cores; Report->names[i] != NULL; i++)
+        printLevelCSVHeader(out, Report->names[i]);
+    if (Report->names[cores] == NULL)
+        printLevelCSVHeader(out, "L2");
+    fprintf(out, ",bus_reads,bus_reads_exclusive,upgrades,invalidations,transfers,flushes");
+    fprintf(out, ",dram_reads,dram_writes,dram_read_bytes,dram_write_bytes\n");
+}
+
+void printStatsCSV(FILE *out, const StatsReport *Report) {
+    uint32_t cores = Report->cores ? Report->cores : 1;
+    LevelStats First = getFirstLevel(Report);
+    CoherenceStats Bus;
+
+    if (Report->coherence != NULL)
+        Bus = *Report->coherence;
+    else
+        memset(&Bus, 0, sizeof(Bus));
+    fprintf(out, "%llu,%llu,%llu,%.4f", (unsigned long long)Report->time, (unsigned long long)Report->cycles,
+            (unsigned long long)getAccesses(&First), getAMAT(Report));
+    printLevelCSV(out, &First);
+    for (int i = cores; Report->names[i] != NULL; i++)
+        printLevelCSV(out, Report->levels[i]);
+    if (Report->names[cores] == NULL) {
+        LevelStats None;
+        memset(&None, 0, sizeof(None));
+        printLevelCSV(out, &None);
+    }
+    fprintf(out, ",%llu,%llu,%llu,%llu,%llu,%llu",
+            (unsigned long long)Bus.busReads, (unsigned long long)Bus.busReadsX,
+            (unsigned long long)Bus.upgrades, (unsigned long long)Bus.invalidations,
+            (unsigned long long)Bus.transfers, (unsigned long long)Bus.flushes);
+    fprintf(out, ",%llu,%llu,%llu,%llu\n",
+            (unsigned long long)Report->dram->accesses[MODE_READ], (unsigned long long)Report->dram->accesses[MODE_WRITE],
+            (unsigned long long)Report->dram->bytes[MODE_READ], (unsigned long long)Report->dram->bytes[MODE_WRITE]);
+}
+
+/* One line per class and mode with its tail percentiles */
+void printLatencyReport(FILE *out, const LatencyStats *Stats) {
+    static const char *ModeNames[2] = { "write", "read" };      // by MODE_*
+    LatencyHistogram All[2];
+
+    getModeLatency(&All[MODE_READ], Stats, MODE_READ);
+    getModeLatency(&All[MODE_WRITE], Stats, MODE_WRITE);
+    fprintf(out, "%-12s %-6s %12s %8s %8s %8s %8s\n", "Latency", "Mode", "Count", "p50", "p99", "p99.9", "Max");
+    for (uint32_t c = 0; c <= NUM_LATENCY_CLASSES; c++) {
+        for (int mode = MODE_READ; mode >= MODE_WRITE; mode--) {
+            const LatencyHistogram *Histogram = c < NUM_LATENCY_CLASSES ? &Stats->classes[c][mode] : &All[mode];
+            if (Histogram->count == 0)
+                continue;
+            fprintf(out, "%-12s %-6s %12llu %8llu %8llu %8llu %8llu\n",
+                    c < NUM_LATENCY_CLASSES ? LatencyClassNames[c] : "all", ModeNames[mode],
+                    (unsigned long long)Histogram->count,
+                    (unsigned long long)getLatencyPercentile(Histogram, 50.0),
+                    (unsigned long long)getLatencyPercentile(Histogram, 99.0),
+                    (unsigned long long)getLatencyPercentile(Histogram, 99.9), (unsigned long long)Histogram->max);
+        }
+    }
+}
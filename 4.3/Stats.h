@@ -0,0 +1,142 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "HashMap.h"
+
+/* Counters are indexed by mode (MODE_READ / MODE_WRITE) so the hot path
+   only does an add, no branches. */
+typedef struct LevelStats {
+  uint64_t hits[2];
+  uint64_t misses[2];
+  uint64_t compulsory;      // only filled in when miss classification is on
+  uint64_t capacity;
+  uint64_t conflict;
+  uint64_t evictions;
+  uint64_t dirtyEvictions;
+  uint64_t prefetches;      // blocks the prefetcher brought in
+  uint64_t prefetchHits;    // of those, used by a demand access
+  uint64_t prefetchLate;    // used before the fill had arrived
+  uint64_t prefetchUseless; // evicted or invalidated unused
+  uint64_t victimHits;      // misses served by the victim cache
+  uint64_t bufferedWrites;  // write backs that went through the write buffer
+  uint64_t bufferStalls;    // of those, found the buffer full
+  uint64_t writeThroughs;   // write hits passed on by a write-through level
+  uint64_t writeArounds;    // write misses passed on without allocating
+  uint64_t traffic[2];      // bytes read from / written to the next level, by mode
+  uint64_t backInvalidations; // blocks an inclusive level removed from the levels above
+  uint64_t mshrMerges;      // misses to a block already being fetched, event timing only
+  uint64_t mshrStalls;      // misses that found every MSHR busy
+} LevelStats;
+
+/* Snooping bus traffic between the private L1s of a multi-core simulator */
+typedef struct CoherenceStats {
+  uint64_t busReads;        // BusRd, a read miss
+  uint64_t busReadsX;       // BusRdX, a write miss
+  uint64_t upgrades;        // BusUpgr, a write hit on a Shared line
+  uint64_t invalidations;   // lines invalidated in other cores
+  uint64_t transfers;       // blocks supplied cache to cache
+  uint64_t flushes;         // Modified blocks written back to L2 on a snoop
+} CoherenceStats;
+
+typedef struct DRAMStats {
+  uint64_t accesses[2];
+  uint64_t bytes[2];
+} DRAMStats;
+
+/* Tracks every block a level sees, in order to split its misses into
+   compulsory (never seen), capacity (would miss in a fully associative
+   LRU cache of the same size) and conflict (the rest). */
+typedef struct MissClassifier {
+  uint32_t capacity;        // lines in the level
+  uint32_t count;
+  uint32_t head;            // shadow LRU list, as node numbers
+  uint32_t tail;
+  HashMap seen;             // every block number ever accessed
+  HashMap present;          // block number -> node, for blocks in the shadow cache
+  uint64_t *block;          // per node
+  uint32_t *prev;
+  uint32_t *next;
+} MissClassifier;
+
+/* Per access latency in the style of an HDR histogram: values below
+   2^LATENCY_SUB_BITS get a bucket each, above that every power of two is
+   split into 2^(LATENCY_SUB_BITS - 1) buckets, so a percentile is off by
+   less than 1 / 2^(LATENCY_SUB_BITS - 1) of its value over the whole
+   64 bit range. */
+#define LATENCY_SUB_BITS 6
+#define LATENCY_BUCKETS ((1 << LATENCY_SUB_BITS) + (64 - LATENCY_SUB_BITS) * (1 << (LATENCY_SUB_BITS - 1)))
+
+typedef struct LatencyHistogram {
+  uint64_t count;
+  uint64_t max;
+  uint64_t counts[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+/* Where an access was served from. An L1 miss that wrote a dirty block
+   back on its way, from any level, counts as LATENCY_WRITE_BACK. */
+#define LATENCY_L1_HIT 0
+#define LATENCY_L2_HIT 1          // or another core's L1
+#define LATENCY_DRAM 2
+#define LATENCY_WRITE_BACK 3
+#define NUM_LATENCY_CLASSES 4
+
+/* By class and mode */
+typedef struct LatencyStats {
+  LatencyHistogram classes[NUM_LATENCY_CLASSES][2];
+} LatencyStats;
+
+MissClassifier *createClassifier(uint32_t);
+
+void resetClassifier(MissClassifier *);
+
+void freeClassifier(MissClassifier *);
+
+int classifyAccess(MissClassifier *, uint64_t, uint32_t, LevelStats *);
+
+void addLevelStats(LevelStats *, const LevelStats *);
+
+void addDRAMStats(DRAMStats *, const DRAMStats *);
+
+void recordLatency(LatencyHistogram *, uint64_t);
+
+uint64_t getLatencyPercentile(const LatencyHistogram *, double);
+
+void addLatencyHistogram(LatencyHistogram *, const LatencyHistogram *);
+
+void addLatencyStats(LatencyStats *, const LatencyStats *);
+
+const char *getLatencyClassName(uint32_t);
+
+/*********************** Reports *************************/
+
+#define STATS_JSON 0
+#define STATS_CSV 1
+
+#define MAX_REPORT_LEVELS 20
+
+/* The first `cores` levels are the private L1s. JSON lists each of them,
+   CSV sums them into one set of L1 columns so that sweeps over the core
+   count still line up, and always has L2 columns (zeros without an L2)
+   so that sweeps over levels do too. */
+typedef struct StatsReport {
+  uint64_t time;
+  uint64_t cycles;          // event timing, 0 when it is off
+  uint32_t cores;
+  const char *names[MAX_REPORT_LEVELS];     // NULL terminated
+  const LevelStats *levels[MAX_REPORT_LEVELS];
+  const DRAMStats *dram;
+  const CoherenceStats *coherence;          // NULL for a single core
+  const LatencyStats *latency;              // NULL unless latency_histograms is on
+} StatsReport;
+
+void printStatsJSON(FILE *, const StatsReport *);
+
+void printStatsCSVHeader(FILE *, const StatsReport *);
+
+void printStatsCSV(FILE *, const StatsReport *);
+
+void printLatencyReport(FILE *, const LatencyStats *);
+
+#endif
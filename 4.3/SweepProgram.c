@@ -0,0 +1,386 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "4.3Cache.h"
+#include "../trace/Trace.h"
+
+/*
+ * Runs one trace through many cache configurations at once.
+ *   Sweep [-t threads] [-p] [-c base config] [-s name=value]... [-a name=v1,v2,...]...
+ *         [-f configs] [-o csv] <trace file | ->
+ * Every -a adds an axis, and every line of -f (options separated by spaces
+ * or commas) is one point. The configurations are the cartesian product of
+ * the file lines and the axes, applied on top of the base config. One CSV
+ * row per configuration goes to -o (default stdout). Only timing and
+ * statistics are reported, so the base config starts with tag_only=1.
+ * Every access runs on core 0; multi-core traces go through Replay.
+ *
+ * The trace is decoded once, a chunk at a time, into packed 64 bit word
+ * accesses (address | mode in bit 0). The next chunk is decoded while the worker
+ * threads run the current one. On the first chunk they pull configurations off
+ * a shared counter; each configuration then stays with the worker that took
+ * it. Simulator memory is faulted in by its first access (see Arena.h), so it
+ * ends up on that worker's NUMA node; -p pins worker i to the i-th allowed CPU
+ * to keep it there. pages=thp or pages=hugetlb backs it with huge pages.
+ */
+
+#define CHUNK_ACCESSES (1 << 20)
+#define MAX_AXES 16
+#define MAX_AXIS_VALUES 64
+
+typedef struct Worker {
+  struct Sweep *sweep;
+  uint32_t id;
+} Worker;
+
+typedef struct Axis {
+  char name[64];
+  char *values[MAX_AXIS_VALUES];
+  int count;
+} Axis;
+
+typedef struct Sweep {
+  Simulator **sims;
+  CacheConfig *configs;
+  uint32_t numConfigs;
+  const uint64_t *chunk;        // accesses of the current chunk
+  size_t chunkLength;           // 0 tells the workers to stop
+  atomic_uint nextConfig;
+  uint32_t *owners;             // worker running each configuration
+  int placed;                   // owners is set, after the first chunk
+  int pin;
+  cpu_set_t cpus;               // allowed CPUs, for -p
+  pthread_barrier_t start;
+  pthread_barrier_t done;
+} Sweep;
+
+static void usage() {
+  fprintf(stderr, "usage: Sweep [-t threads] [-p] [-c config] [-s name=value]... [-a name=v1,v2,...]... [-f configs] [-o csv] <trace>\n");
+  exit(-1);
+}
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*********************** Configurations *************************/
+
+static int parseAxis(Axis *axis, char *spec) {
+  char *equals = strchr(spec, '=');
+
+  if (equals == NULL || (size_t)(equals - spec) >= sizeof(axis->name))
+    return -1;
+  memcpy(axis->name, spec, equals - spec);
+  axis->name[equals - spec] = '\0';
+  axis->count = 0;
+  for (char *value = strtok(equals + 1, ","); value != NULL; value = strtok(NULL, ",")) {
+    if (axis->count == MAX_AXIS_VALUES)
+      return -1;
+    axis->values[axis->count++] = value;
+  }
+  return axis->count > 0 ? 0 : -1;
+}
+
+static int loadPoints(const char *path, const CacheConfig *base, CacheConfig **points, uint32_t *count) {
+  char line[1024];
+  uint32_t capacity = 16;
+  FILE *file = fopen(path, "r");
+
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+  *count = 0;
+  *points = malloc(capacity * sizeof(CacheConfig));
+  while (*points != NULL && fgets(line, sizeof(line), file) != NULL) {
+    char *start = line + strspn(line, " \t");
+    if (*start == '#' || *start == '\n' || *start == '\r' || *start == '\0')
+      continue;
+    if (*count == capacity) {
+      capacity *= 2;
+      *points = realloc(*points, capacity * sizeof(CacheConfig));
+      if (*points == NULL)
+        break;
+    }
+    (*points)[*count] = *base;
+    if (parseConfigLine(&(*points)[*count], start) != 0) {
+      fclose(file);
+      return -1;
+    }
+    (*count)++;
+  }
+  fclose(file);
+  return *points != NULL ? 0 : -1;
+}
+
+/* points x every combination of the axis values */
+static CacheConfig *expandAxes(const CacheConfig *points, uint32_t numPoints, const Axis *axes, int numAxes, uint32_t *count) {
+  uint64_t total = numPoints;
+
+  for (int a = 0; a < numAxes; a++)
+    total *= axes[a].count;
+  if (total > UINT32_MAX / sizeof(CacheConfig))
+    return NULL;
+
+  CacheConfig *configs = malloc(total * sizeof(CacheConfig));
+  if (configs == NULL)
+    return NULL;
+
+  for (uint64_t i = 0; i < total; i++) {
+    uint64_t rest = i / numPoints;
+    configs[i] = points[i % numPoints];
+    for (int a = 0; a < numAxes; a++) {
+      const char *value = axes[a].values[rest % axes[a].count];
+      rest /= axes[a].count;
+      if (setConfigOption(&configs[i], axes[a].name, value) != 0) {
+        fprintf(stderr, "bad option %s=%s\n", axes[a].name, value);
+        free(configs);
+        return NULL;
+      }
+    }
+  }
+  *count = (uint32_t)total;
+  return configs;
+}
+
+/*********************** Workers *************************/
+
+static void runChunk(Simulator *Sim, const uint64_t *chunk, size_t length) {
+  uint64_t mask = Sim->config.dramSize != 0 ? Sim->config.dramSize - 1 : UINT64_MAX;
+  uint32_t value;
+
+  for (size_t i = 0; i < length; i++) {
+    uint64_t address = chunk[i] & ~(uint64_t)(WORD_SIZE - 1) & mask;
+    value = (uint32_t)address;
+    accessSimulator(Sim, address, (uint8_t *)(&value), chunk[i] & 1);
+  }
+}
+
+/* Pins the calling thread to the id-th CPU it may run on */
+static void pinWorker(const cpu_set_t *cpus, uint32_t id) {
+  uint32_t count = (uint32_t)CPU_COUNT(cpus), seen = 0;
+  cpu_set_t one;
+
+  for (int cpu = 0; cpu < CPU_SETSIZE && count > 0; cpu++) {
+    if (!CPU_ISSET(cpu, cpus) || seen++ != id % count)
+      continue;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+    return;
+  }
+}
+
+static void *worker(void *argument) {
+  Worker *self = argument;
+  Sweep *sweep = self->sweep;
+
+  if (sweep->pin)
+    pinWorker(&sweep->cpus, self->id);
+  for (;;) {
+    pthread_barrier_wait(&sweep->start);
+    if (sweep->chunkLength == 0)
+      return NULL;
+
+    uint32_t config;
+    if (!sweep->placed) {
+      while ((config = atomic_fetch_add(&sweep->nextConfig, 1)) < sweep->numConfigs) {
+        sweep->owners[config] = self->id;
+        runChunk(sweep->sims[config], sweep->chunk, sweep->chunkLength);
+      }
+    } else {
+      for (config = 0; config < sweep->numConfigs; config++)
+        if (sweep->owners[config] == self->id)
+          runChunk(sweep->sims[config], sweep->chunk, sweep->chunkLength);
+    }
+
+    pthread_barrier_wait(&sweep->done);
+  }
+}
+
+/* Decodes up to CHUNK_ACCESSES word accesses. Records wider than a word
+   are split; a record that does not fit whole is kept for the next chunk. */
+static size_t decodeChunk(TraceReader *reader, uint64_t *chunk, const TraceRecord **pending, size_t *pendingCount) {
+  size_t length = 0;
+
+  for (;;) {
+    if (*pendingCount == 0 && (*pendingCount = nextTraceRecords(reader, pending)) == 0)
+      return length;
+
+    while (*pendingCount > 0) {
+      const TraceRecord *Record = *pending;
+      uint32_t words = (Record->size + WORD_SIZE - 1) / WORD_SIZE;
+      if (words == 0)
+        words = 1;
+      if (length + words > CHUNK_ACCESSES)
+        return length;
+
+      for (uint32_t w = 0; w < words; w++)
+        chunk[length++] = ((Record->address + w * WORD_SIZE) & ~(uint64_t)(WORD_SIZE - 1)) |
+                          (Record->mode == MODE_READ ? MODE_READ : MODE_WRITE);
+      (*pending)++;
+      (*pendingCount)--;
+    }
+  }
+}
+
+/*********************** Main *************************/
+
+int main(int argc, char **argv) {
+
+  CacheConfig base = getDefaultConfig();
+  base.tagOnly = 1;
+  CacheConfig *points = NULL;
+  uint32_t numPoints = 1;
+  Axis axes[MAX_AXES];
+  int numAxes = 0, numThreads = 0;
+  const char *pointsPath = NULL, *outPath = NULL;
+  Sweep sweep;
+  memset(&sweep, 0, sizeof(sweep));
+
+  int arg = 1;
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    if (strcmp(argv[arg], "-p") == 0) {
+      sweep.pin = 1;
+      arg--;
+    }
+    else if (strcmp(argv[arg], "-t") == 0)
+      numThreads = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "-c") == 0 && loadConfigFile(&base, argv[arg + 1]) == 0)
+      continue;
+    else if (strcmp(argv[arg], "-s") == 0 && parseConfigOption(&base, argv[arg + 1]) == 0)
+      continue;
+    else if (strcmp(argv[arg], "-a") == 0 && numAxes < MAX_AXES && parseAxis(&axes[numAxes], argv[arg + 1]) == 0)
+      numAxes++;
+    else if (strcmp(argv[arg], "-f") == 0)
+      pointsPath = argv[arg + 1];
+    else if (strcmp(argv[arg], "-o") == 0)
+      outPath = argv[arg + 1];
+    else
+      usage();
+  }
+  if (arg != argc - 1)
+    usage();
+
+  if (pointsPath != NULL) {
+    if (loadPoints(pointsPath, &base, &points, &numPoints) != 0 || numPoints == 0)
+      return -1;
+  } else {
+    points = malloc(sizeof(CacheConfig));
+    if (points == NULL)
+      return -1;
+    points[0] = base;
+  }
+
+  sweep.configs = expandAxes(points, numPoints, axes, numAxes, &sweep.numConfigs);
+  free(points);
+  if (sweep.configs == NULL)
+    return -1;
+
+  sweep.sims = calloc(sweep.numConfigs, sizeof(Simulator *));
+  sweep.owners = calloc(sweep.numConfigs, sizeof(uint32_t));
+  for (uint32_t i = 0; sweep.sims != NULL && i < sweep.numConfigs; i++) {
+    sweep.sims[i] = createSimulator(&sweep.configs[i]);
+    if (sweep.sims[i] == NULL) {
+      fprintf(stderr, "configuration %u is invalid:\n", i);
+      printConfig(stderr, &sweep.configs[i]);
+      return -1;
+    }
+    resetSimulator(sweep.sims[i]);
+  }
+  if (sweep.sims == NULL || sweep.owners == NULL)
+    return -1;
+
+  int haveCpus = sched_getaffinity(0, sizeof(sweep.cpus), &sweep.cpus) == 0;
+  if (!haveCpus)
+    sweep.pin = 0;
+  if (numThreads <= 0)
+    numThreads = haveCpus ? CPU_COUNT(&sweep.cpus) : 1;
+  if ((uint32_t)numThreads > sweep.numConfigs)
+    numThreads = sweep.numConfigs;
+
+  TraceReader reader;
+  if (openTrace(&reader, argv[arg]) != 0)
+    return -1;
+
+  uint64_t *chunks[2] = { malloc(CHUNK_ACCESSES * sizeof(uint64_t)), malloc(CHUNK_ACCESSES * sizeof(uint64_t)) };
+  pthread_t *threads = malloc(numThreads * sizeof(pthread_t));
+  Worker *workers = malloc(numThreads * sizeof(Worker));
+  if (chunks[0] == NULL || chunks[1] == NULL || threads == NULL || workers == NULL)
+    return -1;
+
+  pthread_barrier_init(&sweep.start, NULL, numThreads + 1);
+  pthread_barrier_init(&sweep.done, NULL, numThreads + 1);
+  for (int t = 0; t < numThreads; t++) {
+    workers[t].sweep = &sweep;
+    workers[t].id = (uint32_t)t;
+    pthread_create(&threads[t], NULL, worker, &workers[t]);
+  }
+
+  const TraceRecord *pending = NULL;
+  size_t pendingCount = 0;
+  uint64_t accesses = 0;
+  double start = now();
+  int current = 0;
+  size_t length = decodeChunk(&reader, chunks[current], &pending, &pendingCount);
+
+  while (length > 0) {
+    sweep.chunk = chunks[current];
+    sweep.chunkLength = length;
+    atomic_store(&sweep.nextConfig, 0);
+    pthread_barrier_wait(&sweep.start);
+
+    accesses += length;
+    current ^= 1;
+    length = decodeChunk(&reader, chunks[current], &pending, &pendingCount);
+
+    pthread_barrier_wait(&sweep.done);
+    sweep.placed = 1;
+  }
+  sweep.chunkLength = 0;
+  pthread_barrier_wait(&sweep.start);
+  for (int t = 0; t < numThreads; t++)
+    pthread_join(threads[t], NULL);
+  double seconds = now() - start;
+  closeTrace(&reader);
+
+  FILE *out = outPath == NULL || strcmp(outPath, "-") == 0 ? stdout : fopen(outPath, "w");
+  if (out == NULL) {
+    perror(outPath);
+    return -1;
+  }
+  for (uint32_t i = 0; i < sweep.numConfigs; i++) {
+    StatsReport Report = getSimulatorStats(sweep.sims[i]);
+    if (i == 0) {
+      printConfigCSVHeader(out);
+      fprintf(out, ",");
+      printStatsCSVHeader(out, &Report);
+    }
+    printConfigCSV(out, &sweep.configs[i]);
+    fprintf(out, ",");
+    printStatsCSV(out, &Report);
+    freeSimulator(sweep.sims[i]);
+  }
+  if (out != stdout)
+    fclose(out);
+
+  fprintf(stderr, "Configurations: %u, threads: %d\n", sweep.numConfigs, numThreads);
+  fprintf(stderr, "Accesses: %llu per configuration\n", (unsigned long long)accesses);
+  fprintf(stderr, "Host seconds: %.3f\n", seconds);
+  fprintf(stderr, "Simulated accesses/sec: %.0f\n", seconds > 0 ? accesses * (double)sweep.numConfigs / seconds : 0.0);
+
+  pthread_barrier_destroy(&sweep.start);
+  pthread_barrier_destroy(&sweep.done);
+  free(chunks[0]);
+  free(chunks[1]);
+  free(threads);
+  free(workers);
+  free(sweep.owners);
+  free(sweep.sims);
+  free(sweep.configs);
+  return 0;
+}
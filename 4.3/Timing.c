@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include "Timing.h"
+
+#define MSHR_FREE UINT64_MAX
+
+int initMshrFile(MshrFile *File, uint32_t entries) {
+    File->entries = entries;
+    File->blocks = malloc(entries * sizeof(uint64_t));
+    File->done = malloc(entries * sizeof(uint64_t));
+    if (File->blocks == NULL || File->done == NULL) {
+        freeMshrFile(File);
+        return -1;
+    }
+    resetMshrFile(File);
+    return 0;
+}
+
+void freeMshrFile(MshrFile *File) {
+    free(File->blocks);
+    free(File->done);
+    File->blocks = NULL;
+    File->done = NULL;
+    File->entries = 0;
+    File->count = 0;
+}
+
+void resetMshrFile(MshrFile *File) {
+    for (uint32_t slot = 0; slot < File->entries; slot++) {
+        File->blocks[slot] = MSHR_FREE;
+        File->done[slot] = 0;
+    }
+    File->count = 0;
+}
+
+/* The entry already fetching block, NO_MSHR if none */
+uint32_t findMshr(const MshrFile *File, uint64_t block) {
+    if (File->count == 0)
+        return NO_MSHR;
+    for (uint32_t slot = 0; slot < File->entries; slot++)
+        if (File->blocks[slot] == block)
+            return slot;
+    return NO_MSHR;
+}
+
+/* Takes a free entry, the caller makes sure there is one */
+uint32_t allocMshr(MshrFile *File, uint64_t block, uint64_t done) {
+    uint32_t slot = 0;
+
+    while (File->blocks[slot] != MSHR_FREE)
+        slot++;
+    File->blocks[slot] = block;
+    File->done[slot] = done;
+    File->count++;
+    return slot;
+}
+
+void releaseMshr(MshrFile *File, uint32_t slot) {
+    File->blocks[slot] = MSHR_FREE;
+    File->count--;
+}
+
+int initEventQueue(EventQueue *Queue, uint32_t capacity) {
+    Queue->capacity = capacity;
+    Queue->count = 0;
+    Queue->events = malloc(capacity * sizeof(TimingEvent));
+    return Queue->events != NULL ? 0 : -1;
+}
+
+void freeEventQueue(EventQueue *Queue) {
+    free(Queue->events);
+    Queue->events = NULL;
+    Queue->capacity = 0;
+    Queue->count = 0;
+}
+
+/* There is room for one event per MSHR, so it never overflows */
+void pushEvent(EventQueue *Queue, uint64_t time, uint32_t level, uint32_t slot) {
+    TimingEvent *Events = Queue->events;
+    uint32_t i = Queue->count++;
+
+    while (i > 0 && Events[(i - 1) / 2].time > time) {   // sift up
+        Events[i] = Events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    Events[i].time = time;
+    Events[i].level = level;
+    Events[i].slot = slot;
+}
+
+/* Removes the earliest event, the queue must not be empty */
+TimingEvent popEvent(EventQueue *Queue) {
+    TimingEvent *Events = Queue->events;
+    TimingEvent First = Events[0];
+    TimingEvent Last = Events[--Queue->count];
+    uint32_t i = 0;
+
+    for (;;) {                                            // sift down
+        uint32_t child = 2 * i + 1;
+        if (child >= Queue->count)
+            break;
+        if (child + 1 < Queue->count && Events[child + 1].time < Events[child].time)
+            child++;
+        if (Events[child].time >= Last.time)
+            break;
+        Events[i] = Events[child];
+        i = child;
+    }
+    if (Queue->count > 0)
+        Events[i] = Last;
+    return First;
+}
@@ -0,0 +1,54 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+
+/* Pieces of the event driven timing model: the miss status holding
+   registers of a level (the blocks it is fetching and when each arrives)
+   and a queue of the times they free up, earliest first. The simulator
+   decides what goes in them. */
+
+#define MAX_MSHRS 64
+#define NO_MSHR UINT32_MAX
+
+typedef struct MshrFile {
+  uint32_t entries;
+  uint32_t count;         // busy entries
+  uint64_t *blocks;       // block number being fetched, UINT64_MAX when free
+  uint64_t *done;         // when its fill completes
+} MshrFile;
+
+typedef struct TimingEvent {
+  uint64_t time;
+  uint32_t level;         // whose MSHR frees up
+  uint32_t slot;
+} TimingEvent;
+
+/* Binary min heap on time */
+typedef struct EventQueue {
+  uint32_t capacity;
+  uint32_t count;
+  TimingEvent *events;
+} EventQueue;
+
+int initMshrFile(MshrFile *, uint32_t);
+
+void freeMshrFile(MshrFile *);
+
+void resetMshrFile(MshrFile *);
+
+uint32_t findMshr(const MshrFile *, uint64_t);
+
+uint32_t allocMshr(MshrFile *, uint64_t, uint64_t);
+
+void releaseMshr(MshrFile *, uint32_t);
+
+int initEventQueue(EventQueue *, uint32_t);
+
+void freeEventQueue(EventQueue *);
+
+void pushEvent(EventQueue *, uint64_t, uint32_t, uint32_t);
+
+TimingEvent popEvent(EventQueue *);
+
+#endif
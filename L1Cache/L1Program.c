@@ -2,6 +2,10 @@
 
 int main() {
 
+  CacheConfig config = getL1CacheConfig();
+  if (configureCaches(&config) != 0)
+    return -1;
+
   // set seed for random number generator
   srand(0);
 
@@ -0,0 +1,118 @@
+#include <time.h>
+#include <math.h>
+#include "L2Cache.h"
+#include "../trace/Trace.h"
+
+/*
+ * Microbenchmark for the address decoding on the L1 hit path.
+ * Compares the old libm log2() helpers against the shift/mask ones in
+ * the simulator library, then times a read on a warmed L1. Addresses come from a
+ * trace (folded into L1_SIZE so every access hits) or from a sweep.
+ *   DecodeBench [trace file] [repetitions]
+ */
+
+#define MAX_ADDRESSES (1 << 22)
+
+volatile uint32_t CacheSize = L1_SIZE;   // keeps the old helpers from being constant folded
+
+/* The decoding as it was before, one log2() per helper call */
+static uint32_t oldNumIndexBits(uint32_t cacheSize) { return (uint32_t)log2(cacheSize / BLOCK_SIZE); }
+static uint32_t oldNumBlockOffsetBits() { return (uint32_t)log2(BLOCK_SIZE); }
+static uint32_t oldTag(uint32_t address, uint32_t cacheSize) {
+  return address >> (oldNumBlockOffsetBits() + oldNumIndexBits(cacheSize));
+}
+static uint32_t oldIndex(uint32_t address, uint32_t cacheSize) {
+  return (address >> oldNumBlockOffsetBits()) & createBitMask(oldNumIndexBits(cacheSize));
+}
+static uint32_t oldBlockOffset(uint32_t address) {
+  return address & createBitMask(oldNumBlockOffsetBits());
+}
+static uint32_t oldMemAddress(uint32_t address) {
+  return (address >> oldNumBlockOffsetBits()) << oldNumBlockOffsetBits();
+}
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t loadAddresses(uint32_t *addresses, const char *path) {
+  TraceReader reader;
+  const TraceRecord *records;
+  uint32_t loaded = 0;
+  size_t count;
+
+  if (openTrace(&reader, path) != 0)
+    exit(-1);
+  while (loaded < MAX_ADDRESSES && (count = nextTraceRecords(&reader, &records)) > 0) {
+    for (size_t r = 0; r < count && loaded < MAX_ADDRESSES; r++) {
+      uint32_t address = (uint32_t)(records[r].address % L1_SIZE);
+      addresses[loaded++] = address - address % WORD_SIZE;
+    }
+  }
+  closeTrace(&reader);
+  return loaded;
+}
+
+int main(int argc, char **argv) {
+
+  uint32_t *addresses = malloc(MAX_ADDRESSES * sizeof(uint32_t));
+  uint32_t count = 0, value = 0, check = 0;
+  int repetitions = argc > 2 ? atoi(argv[2]) : 20;
+  double start, oldTime, newTime, hitTime;
+
+  CacheConfig config = getL2CacheConfig();
+  Simulator *Sim = createSimulator(&config);
+  if (addresses == NULL || Sim == NULL)
+    return -1;
+  const CacheLevel *L1 = &Sim->L1[0];
+  if (argc > 1) {
+    count = loadAddresses(addresses, argv[1]);
+  } else {
+    for (count = 0; count < L1_SIZE / WORD_SIZE; count++)
+      addresses[count] = count * WORD_SIZE;
+  }
+  if (count == 0) {
+    fprintf(stderr, "no addresses\n");
+    return -1;
+  }
+
+  start = now();
+  for (int rep = 0; rep < repetitions; rep++)
+    for (uint32_t i = 0; i < count; i++)
+      check += oldTag(addresses[i], CacheSize) ^ oldIndex(addresses[i], CacheSize) ^
+               oldBlockOffset(addresses[i]) ^ oldMemAddress(addresses[i]);
+  oldTime = now() - start;
+
+  start = now();
+  for (int rep = 0; rep < repetitions; rep++)
+    for (uint32_t i = 0; i < count; i++)
+      check -= (uint32_t)(getTag(L1, addresses[i]) ^ getIndex(L1, addresses[i]) ^
+                          getBlockOffset(L1, addresses[i]) ^ getMemAddress(L1, addresses[i]));
+  newTime = now() - start;
+
+  if (check != 0) {
+    fprintf(stderr, "decoders disagree\n");
+    return -1;
+  }
+
+  resetSimulator(Sim);
+  for (uint32_t i = 0; i < count; i++)   // warm up so the timed loop only hits
+    accessSimulator(Sim, addresses[i], (uint8_t *)(&value), MODE_READ);
+  start = now();
+  for (int rep = 0; rep < repetitions; rep++)
+    for (uint32_t i = 0; i < count; i++)
+      accessSimulator(Sim, addresses[i], (uint8_t *)(&value), MODE_READ);
+  hitTime = now() - start;
+
+  double accesses = (double)count * repetitions;
+  printf("Addresses: %u x %d\n", count, repetitions);
+  printf("log2 decode:       %.2f ns/access\n", oldTime / accesses * 1e9);
+  printf("shift/mask decode: %.2f ns/access (%.1fx)\n", newTime / accesses * 1e9, oldTime / newTime);
+  printf("L1 hit path:       %.2f ns/access\n", hitTime / accesses * 1e9);
+
+  freeSimulator(Sim);
+  free(addresses);
+  return 0;
+}
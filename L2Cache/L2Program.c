@@ -2,6 +2,10 @@
 
 int main() {
 
+  CacheConfig config = getL2CacheConfig();
+  if (configureCaches(&config) != 0)
+    return -1;
+
   // set seed for random number generator
   srand(0);
 
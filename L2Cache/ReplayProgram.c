@@ -0,0 +1,78 @@
+#include <time.h>
+#include "L2Cache.h"
+#include "../trace/Trace.h"
+
+/*
+ * Replays a binary trace (see trace/Trace.h) through read()/write().
+ * Addresses are folded into DRAM_SIZE and accesses wider than a word are
+ * split into word accesses. Use -v to print every access like L2Program.
+ */
+
+static double elapsedSeconds(struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv) {
+
+  TraceReader reader;
+  const TraceRecord *records;
+  struct timespec start;
+  uint64_t accesses = 0;
+  size_t count;
+  int verbose = 0;
+  uint32_t value;
+
+  if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+    verbose = 1;
+    argc--;
+    argv++;
+  }
+  if (argc != 2) {
+    fprintf(stderr, "usage: Replay [-v] <trace file | ->\n");
+    return -1;
+  }
+  CacheConfig config = getL2CacheConfig();
+  if (configureCaches(&config) != 0 || openTrace(&reader, argv[1]) != 0)
+    return -1;
+
+  resetTime();
+  initCaches();
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  while ((count = nextTraceRecords(&reader, &records)) > 0) {
+    for (size_t r = 0; r < count; r++) {
+      uint32_t words = (records[r].size + WORD_SIZE - 1) / WORD_SIZE;
+      if (words == 0)
+        words = 1;
+
+      for (uint32_t w = 0; w < words; w++) {
+        uint32_t address = (uint32_t)((records[r].address + w * WORD_SIZE) % DRAM_SIZE);
+        address = address - address % WORD_SIZE;
+
+        if (records[r].mode == MODE_READ) {
+          read(address, (uint8_t *)(&value));
+          if (verbose)
+            printf("Read; Address %d; Value %d; Time %d\n", address, value, getTime());
+        }
+        else {
+          value = address;
+          write(address, (uint8_t *)(&value));
+          if (verbose)
+            printf("Write; Address %d; Value %d; Time %d\n", address, value, getTime());
+        }
+      }
+      accesses += words;
+    }
+  }
+
+  double seconds = elapsedSeconds(&start);
+  closeTrace(&reader);
+
+  printf("Accesses: %llu\n", (unsigned long long)accesses);
+  printf("Time: %u\n", getTime());
+  printf("Host seconds: %.3f\n", seconds);
+  printf("Accesses/sec: %.0f\n", seconds > 0 ? accesses / seconds : 0.0);
+  return 0;
+}
@@ -0,0 +1,35 @@
+#include "../4.3/4.3Cache.h"
+
+/*
+ * Checks of the read()/write() interface that tests/regress.sh runs: one
+ * line per check, "ok" or "FAIL", and a non-zero exit if any failed.
+ */
+
+static int failed = 0;
+
+static void check(const char *name, int passed) {
+  printf("%s %s\n", passed ? "ok  " : "FAIL", name);
+  failed |= !passed;
+}
+
+int main() {
+
+  uint32_t value = 1234;
+
+  write(64, (uint8_t *)(&value));         // no initCaches() yet, as in the original lab code
+  value = 0;
+  read(64, (uint8_t *)(&value));
+  check("read() and write() work before initCaches()", value == 1234 && getTime() > 0);
+
+  initCaches();
+  for (uint32_t address = 0; address < 1024 * BLOCK_SIZE; address += BLOCK_SIZE)
+    read(address, (uint8_t *)(&value));
+  resetStats();
+  resetTime();
+  read(0, (uint8_t *)(&value));
+  StatsReport Report = getStatsReport();
+  check("report time counts from resetStats() then resetTime()", Report.time == getTime() && Report.time > 0);
+
+  freeCaches();
+  return failed;
+}
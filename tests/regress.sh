@@ -0,0 +1,300 @@
+#!/bin/sh
+# Regression checks for the replay tools, run from anywhere (make check in 4.3):
+#   - Replay statistics of a fixed random trace match results_Replay.txt
+#   - a set partitioned replay (-t) gives the same statistics as a serial one
+#   - a run saved half way (-W) and restored (-R) adds up to the whole run
+#   - traces converted to the packed format and back are unchanged
+#   - the reuse profiler counts the same LRU misses as Replay
+#   - sampled estimates fall within their confidence intervals of the full run
+#   - latency histograms count every access once
+#   - the read()/write() interface behaves, see ApiProgram.c
+#   - small hand written traces give the statistics worked out by hand
+# Prints one line per check and exits non-zero if any fails.
+
+cd "$(dirname "$0")/.." || exit 1
+make -s -C trace >/dev/null && make -s -C 4.3 replay reuse >/dev/null || exit 1
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+GEN=trace/TraceGen
+REPLAY=4.3/Replay
+FAILED=0
+
+check() {
+  if [ "$2" -eq 0 ]; then
+    echo "ok   $1"
+  else
+    echo "FAIL $1"
+    FAILED=1
+  fi
+}
+
+# Statistics as one CSV row, without the host timings Replay prints
+stats() {
+  out=$1
+  shift
+  "$REPLAY" -x "$out" "$@" >/dev/null
+}
+
+# The value of column name in the CSV row of file
+field() {
+  awk -F, -v name="$2" 'NR == 1 { for (i = 1; i <= NF; i++) if ($i == name) column = i } NR == 2 { print $column }' "$1"
+}
+
+# Checks every name=value against the CSV row of file, reporting the ones that differ
+expect() {
+  file=$1
+  shift
+  status=0
+  for pair in "$@"; do
+    got=$(field "$file" "${pair%%=*}")
+    if [ "$got" != "${pair#*=}" ]; then
+      echo "     ${pair%%=*}: got $got, expected ${pair#*=}"
+      status=1
+    fi
+  done
+  return $status
+}
+
+# Replays the listing on stdin (see TraceGen text) with the options given, into a CSV row
+known() {
+  $GEN "$TMP/known.trc" text - >/dev/null && "$REPLAY" -x "$TMP/known.csv" "$@" "$TMP/known.trc" >/dev/null
+}
+
+$GEN "$TMP/a.trc" random 200000 262144 1 >/dev/null &&
+$GEN "$TMP/b.trc" random 200000 262144 2 >/dev/null &&
+$GEN "$TMP/ab.trc" convert "$TMP/a.trc" "$TMP/b.trc" >/dev/null || exit 1
+
+# Fixed results
+stats "$TMP/serial.csv" "$TMP/ab.trc"
+diff -q "$TMP/serial.csv" tests/results_Replay.txt >/dev/null
+check "replay statistics match results_Replay.txt" $?
+
+# The reuse profiler against Replay: 64 sets of 4 ways is the default L1
+# made 4 way, 1 set of 256 the same size fully associative
+4.3/Reuse -S 64 "$TMP/ab.trc" > "$TMP/reuse.csv"
+for geometry in "64 4" "1 256"; do
+  set -- $geometry
+  profiled=$(awk -F, -v sets="$1" -v ways="$2" '$1 == sets && $2 == ways { print $4 }' "$TMP/reuse.csv")
+  stats "$TMP/lru.csv" -s l1_ways=$(( $1 == 1 ? 0 : $2 )) -s l1_replacement=lru "$TMP/ab.trc"
+  replayed=$(( $(field "$TMP/lru.csv" L1_read_misses) + $(field "$TMP/lru.csv" L1_write_misses) ))
+  [ -n "$profiled" ] && [ "$profiled" -eq "$replayed" ]
+  check "reuse profile misses equal Replay LRU misses ($1 sets of $2 ways: $profiled, $replayed)" $?
+done
+
+# Sampling: each estimate's 95% interval holds the value of the full run (a
+# fixed trace and period, so this does not come and go with the 1 in 20)
+"$REPLAY" -p 10000,1000,1000 "$TMP/ab.trc" > "$TMP/sampled.txt"
+for estimate in "time per access:amat" "L1 miss rate:L1_miss_rate" "L2 miss rate:L2_miss_rate"; do
+  full=$(field "$TMP/serial.csv" "${estimate#*:}")
+  awk -v name="Estimated ${estimate%%:*}:" -v full="$full" '
+    index($0, name) == 1 { found = 1; value = $(NF - 2); halfWidth = $NF }
+    END { exit !(found && value - halfWidth <= full && full <= value + halfWidth) }' "$TMP/sampled.txt"
+  check "sampled ${estimate%%:*} holds the full run's $full" $?
+done
+
+# Latency histograms: the classes of each mode add up to its all line, and
+# the all lines to the accesses
+"$REPLAY" -s latency_histograms=1 "$TMP/ab.trc" > "$TMP/latency.txt"
+awk '
+  $1 == "Accesses:" { accesses = $2 }
+  $1 == "Latency" { table = 1; next }
+  table && $1 == "all" { all[$2] = $3; total += $3; next }
+  table { classes[$2] += $3 }
+  END { exit !(accesses > 0 && total == accesses && all["read"] == classes["read"] && all["write"] == classes["write"]) }' \
+  "$TMP/latency.txt"
+check "latency histograms count every access once" $?
+
+# Serial against partitioned
+for config in "" "-s l1_ways=4 -s l2_ways=8 -s l1_replacement=plru" "-s inclusion=inclusive -s l1_ways=2"; do
+  stats "$TMP/one.csv" $config "$TMP/ab.trc"
+  stats "$TMP/four.csv" -t 4 $config "$TMP/ab.trc"
+  cmp -s "$TMP/one.csv" "$TMP/four.csv"
+  check "partitioned replay equals serial ($config)" $?
+done
+
+# Save and restore: the first half plus the restored second half is the whole run,
+# column by column for the counters (ratios are left out)
+for config in "" "-s timing=event" "-s l1_write_buffer=4 -s l1_victim_entries=4"; do
+  stats "$TMP/whole.csv" $config "$TMP/ab.trc"
+  stats "$TMP/first.csv" $config -W "$TMP/half.snap" "$TMP/a.trc"
+  stats "$TMP/second.csv" -R "$TMP/half.snap" "$TMP/b.trc"
+  awk -F, '
+    FNR == 1 { file++; next }
+    { for (i = 1; i <= NF; i++) value[file, i] = $i; fields = NF }
+    END {
+      for (i = 1; i <= fields; i++) {
+        if (value[1, i] !~ /^[0-9]+$/ || i == 2)    # ratios, and cycles, which are not additive
+          continue;
+        if (value[1, i] != value[2, i] + value[3, i])
+          exit 1;
+      }
+    }' "$TMP/whole.csv" "$TMP/first.csv" "$TMP/second.csv"
+  check "restored run adds up to the whole run ($config)" $?
+done
+
+# Known answers, worked out by hand from the times in Cache.h
+
+# MESI: core 0 writes a block (BusRdX, Modified, 100 + 10 + 1), core 1 reads it
+# (BusRd, flushed to the L2 and transferred, both Shared, 10 + 5 + 1), then
+# writes it (BusUpgr invalidating core 0, 1)
+known -s cores=2 <<EOF
+w 0 0
+r 0 1
+w 0 1
+EOF
+expect "$TMP/known.csv" bus_reads=1 bus_reads_exclusive=1 upgrades=1 invalidations=1 transfers=1 flushes=1 \
+  dram_reads=1 time=128
+check "MESI: Modified to Shared by a transfer, then an upgrade invalidates" $?
+
+# Inclusive: one set of two blocks in each level. The L1 hit on 0 leaves it
+# least recent in the L2, so filling 128 evicts it there and back-invalidates
+# it from the L1 (which itself evicts 64): the last read of 0 misses again.
+# Four misses at 100 + 10 + 1 and one hit.
+known -s inclusion=inclusive -s l1_size=128 -s l1_ways=0 -s l2_size=128 -s l2_ways=0 <<EOF
+r 0
+r 64
+r 0
+r 128
+r 0
+EOF
+expect "$TMP/known.csv" L2_back_invalidations=1 L1_evictions=1 L1_read_hits=1 L1_read_misses=4 dram_reads=4 time=445
+check "inclusive L2 evictions back-invalidate the L1" $?
+
+# Exclusive: the same levels hold four blocks between them. After four cold
+# misses every read comes from the L2, and since fills take blocks out of it
+# the six L1 evictions it takes in never make it evict. 4 * 111 + 4 * 11 for
+# the reads and 6 * 5 for the evictions written into the L2.
+known -s inclusion=exclusive -s l1_size=128 -s l1_ways=0 -s l2_size=128 -s l2_ways=0 <<EOF
+r 0
+r 64
+r 128
+r 192
+r 0
+r 64
+r 128
+r 192
+EOF
+expect "$TMP/known.csv" L2_read_hits=4 L2_evictions=0 L2_write_misses=6 dram_reads=4 time=518
+check "exclusive L1 fills move blocks out of the L2" $?
+
+# Event timing: four cold read misses, 110 cycles of fill and 1 of L1 read
+# each. With 8 MSHRs the core issues one a cycle and the fills overlap: the
+# last completes at 3 + 111. With 2 the third waits for the first fill to
+# free its MSHR at 110 and the fourth goes out at 111, done at 111 + 111.
+# The additive time is the serial 4 * 111 either way.
+cat > "$TMP/misses.txt" <<EOF
+r 0
+r 64
+r 128
+r 192
+EOF
+known -s timing=event -s l1_mshrs=8 < "$TMP/misses.txt"
+expect "$TMP/known.csv" cycles=114 time=444 L1_mshr_stalls=0
+check "event timing overlaps misses in the MSHRs" $?
+known -s timing=event -s l1_mshrs=2 < "$TMP/misses.txt"
+expect "$TMP/known.csv" cycles=222 time=444 L1_mshr_stalls=1
+check "event timing stalls when the MSHRs are full" $?
+
+# Prefetchers: one word from each of eight consecutive blocks.
+cat > "$TMP/sequential.txt" <<EOF
+r 0
+r 64
+r 128
+r 192
+r 256
+r 320
+r 384
+r 448
+EOF
+# Next line, one ahead: only the first read misses, every trigger fetches the
+# following block (8 of them, the last never used), and each arrives 110
+# cycles after it was sent, after the read that wants it: all late, so the
+# time is the serial 8 * 111.
+known -s l1_prefetcher=next_line -s l1_prefetch_degree=1 < "$TMP/sequential.txt"
+expect "$TMP/known.csv" L1_read_misses=1 L1_prefetches=8 L1_prefetch_hits=7 L1_prefetch_late=7 dram_reads=9 time=888
+check "next line prefetching turns misses into prefetch hits" $?
+# Stream, four ahead: blocks 0 and 1 miss and confirm the stream, which
+# fetches 2 to 5 back to back (ready at 332, 442, 552, 662), then one more
+# per trigger. Reads 2 to 5 wait for theirs, 6 and 7 find them there.
+known -s l1_prefetcher=stream -s l1_prefetch_degree=4 < "$TMP/sequential.txt"
+expect "$TMP/known.csv" L1_read_misses=2 L1_prefetches=10 L1_prefetch_hits=6 L1_prefetch_late=4 time=665
+check "stream prefetching turns misses into prefetch hits" $?
+
+# Victim cache: 0 and 16384 share a set of the direct mapped L1. With one
+# victim entry, after the two cold misses (111 each) each read swaps the
+# other block back out of the victim cache for two L1 cycles.
+known -s l1_victim_entries=1 <<EOF
+r 0
+r 16384
+r 0
+r 16384
+EOF
+expect "$TMP/known.csv" L1_victim_hits=2 L1_read_misses=4 dram_reads=2 time=226
+check "a victim cache catches conflict misses" $?
+
+# Write buffer: three writes to one L1 set, each miss (111) evicting the
+# previous dirty block once its fill is in. With one buffer entry the write
+# back goes on in the background and the first (an L2 hit, 5) is done long
+# before the second is queued: nothing waits.
+known -s l1_write_buffer=1 <<EOF
+w 0
+w 16384
+w 32768
+EOF
+expect "$TMP/known.csv" L1_dirty_evictions=2 L1_buffered_writes=2 L1_buffer_stalls=0 time=333
+check "a write buffer takes write backs off the critical path" $?
+
+# Write through both levels: after the read miss (111) each word written
+# goes through the L1 (1) and the L2 (5) to DRAM (50), 4 bytes at a time.
+known -s l1_write_policy=write_through -s l2_write_policy=write_through <<EOF
+r 0
+w 0
+w 4
+w 8
+EOF
+expect "$TMP/known.csv" L1_write_hits=3 L1_write_throughs=3 L2_write_throughs=3 dram_writes=3 dram_write_bytes=12 \
+  time=279
+check "write through levels pass every write on to DRAM" $?
+
+# No write allocate in both levels: three write misses go around both to
+# DRAM for 1 + 5 + 50, nothing is filled, so the read of 0 misses (111).
+known -s l1_write_miss=no_allocate -s l2_write_miss=no_allocate <<EOF
+w 0
+w 64
+w 128
+r 0
+EOF
+expect "$TMP/known.csv" L1_write_arounds=3 L2_write_arounds=3 L1_read_misses=1 dram_writes=3 dram_reads=1 time=279
+check "no write allocate writes around both levels" $?
+
+# Latency percentiles: 0 and 16384 share an L1 set but not an L2 one, so
+# after their cold misses (111 each) reading them in turn hits the L2 (11),
+# 13 times, and the last one read then hits the L1 (1) 985 times. Of the
+# 1000 reads the 500th and 990th take 1 and 11, the 999th and 1000th 111.
+awk 'BEGIN {
+  print "r 0"
+  print "r 16384"
+  for (i = 0; i < 13; i++)
+    print "r " (i % 2 ? 16384 : 0)
+  for (i = 0; i < 985; i++)
+    print "r 0"
+}' | $GEN "$TMP/known.trc" text - >/dev/null
+"$REPLAY" -s latency_histograms=1 "$TMP/known.trc" > "$TMP/latency.txt"
+grep -q "^all  *read  *1000  *1  *11  *111  *111$" "$TMP/latency.txt" &&
+grep -q "^L2_hit  *read  *13 " "$TMP/latency.txt"
+check "latency percentiles of 985 L1 hits, 13 L2 hits and 2 misses" $?
+
+# The read()/write() interface, which prints its own check lines
+gcc -Wall -Wextra -O2 tests/ApiProgram.c 4.3/libcache.a -o "$TMP/api" -lm && "$TMP/api" || FAILED=1
+
+# Packed traces
+$GEN -p "$TMP/packed.trc" convert "$TMP/ab.trc" >/dev/null &&
+$GEN "$TMP/unpacked.trc" convert "$TMP/packed.trc" >/dev/null &&
+cmp -s "$TMP/ab.trc" "$TMP/unpacked.trc"
+check "version 1 -> 2 -> 1 trace round trip is byte identical" $?
+stats "$TMP/packed.csv" "$TMP/packed.trc"
+cmp -s "$TMP/serial.csv" "$TMP/packed.csv"
+check "packed trace replays like the original" $?
+
+exit $FAILED
@@ -0,0 +1,433 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Trace.h"
+
+#define TRACE_START_SIZE 4          // size and core a packed chunk starts from
+#define MAX_PACKED_RECORD 12        // 10 byte varint, size and core
+#define MAX_CHUNK_BYTES (2 * (TRACE_BUFFER_RECORDS / 8) + TRACE_BUFFER_RECORDS * MAX_PACKED_RECORD)
+
+/*********************** Packing *************************/
+
+static uint8_t *putVarint(uint8_t *out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+/* Encodes count records into payload, returns its length */
+static uint32_t packChunk(const TraceRecord *records, uint32_t count, uint8_t *payload) {
+    uint32_t bitmap = (count + 7) / 8;
+    uint8_t *modes = payload, *changes = payload + bitmap, *out = payload + 2 * bitmap;
+    uint64_t address = 0;
+    uint8_t size = TRACE_START_SIZE, core = 0;
+
+    memset(payload, 0, 2 * bitmap);
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t delta = records[i].address - address;
+        int changed = records[i].size != size || records[i].core != core;
+        modes[i / 8] |= (uint8_t)((records[i].mode == TRACE_MODE_READ) << (i % 8));
+        changes[i / 8] |= (uint8_t)(changed << (i % 8));
+        out = putVarint(out, (delta << 1) ^ (uint64_t)((int64_t)delta >> 63));
+        if (changed) {
+            *out++ = size = records[i].size;
+            *out++ = core = records[i].core;
+        }
+        address = records[i].address;
+    }
+    return (uint32_t)(out - payload);
+}
+
+/* Decodes a chunk of count records into records, -1 if the payload is
+   short or malformed. One byte deltas take the fast path. */
+static int unpackChunk(const uint8_t *payload, uint32_t bytes, uint32_t count, TraceRecord *records) {
+    uint32_t bitmap = (count + 7) / 8;
+    const uint8_t *modes = payload, *changes = payload + bitmap;
+    const uint8_t *in = payload + 2 * bitmap, *end = payload + bytes;
+    uint64_t address = 0;
+    uint8_t size = TRACE_START_SIZE, core = 0;
+
+    if (bytes < 2 * bitmap)
+        return -1;
+    for (uint32_t i = 0; i < count; i++) {
+        if (in >= end)
+            return -1;
+        uint64_t value = *in++;
+        if (value >= 0x80) {
+            uint32_t shift = 7;
+            uint8_t byte;
+            value &= 0x7f;
+            do {
+                if (in >= end || shift > 63)
+                    return -1;
+                byte = *in++;
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte >= 0x80);
+        }
+        address += (value >> 1) ^ (0 - (value & 1));
+        if (changes[i / 8] & (1 << (i % 8))) {
+            if (end - in < 2)
+                return -1;
+            size = *in++;
+            core = *in++;
+        }
+        records[i].address = address;
+        records[i].mode = (modes[i / 8] >> (i % 8)) & 1 ? TRACE_MODE_READ : TRACE_MODE_WRITE;
+        records[i].size = size;
+        records[i].core = core;
+        memset(records[i].reserved, 0, sizeof(records[i].reserved));
+    }
+    return in == end ? 0 : -1;
+}
+
+/*********************** Reading *************************/
+
+static int checkHeader(const TraceHeader *header, const char *path) {
+    if (header->magic != TRACE_MAGIC || (header->version != TRACE_VERSION && header->version != TRACE_VERSION_PACKED)) {
+        fprintf(stderr, "%s: not a version %d or %d trace file\n", path, TRACE_VERSION, TRACE_VERSION_PACKED);
+        return -1;
+    }
+    return 0;
+}
+
+/* Finds the chunk index of a mapped packed trace, leaves it NULL if the
+   footer is missing or does not add up (a truncated file still streams) */
+static void mapIndex(TraceReader *reader) {
+    TraceFooter footer;
+    const uint8_t *base = reader->mapBase;
+
+    if (reader->mapLength < sizeof(TraceHeader) + sizeof(footer))
+        return;
+    memcpy(&footer, base + reader->mapLength - sizeof(footer), sizeof(footer));
+    if (footer.magic != TRACE_INDEX_MAGIC || footer.indexOffset < sizeof(TraceHeader) ||
+        footer.indexOffset > reader->mapLength - sizeof(footer) ||
+        (reader->mapLength - sizeof(footer) - footer.indexOffset) / sizeof(TraceIndexEntry) != footer.chunks ||
+        footer.indexOffset % sizeof(uint64_t) != 0)
+        return;
+    reader->index = (const TraceIndexEntry *)(base + footer.indexOffset);
+    reader->chunks = footer.chunks;
+    reader->end = base + footer.indexOffset;
+}
+
+/* Maps the whole file so records are handed out without copying.
+   Returns 1 if mapped, 0 if the caller should fall back to buffered reads. */
+static int mapTrace(TraceReader *reader, const char *path) {
+    struct stat info;
+    int fd = fileno(reader->file);
+
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || (size_t)info.st_size < sizeof(TraceHeader))
+        return 0;
+
+    void *base = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+        return 0;
+    madvise(base, info.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    const TraceHeader *header = (const TraceHeader *)base;
+    if (checkHeader(header, path) != 0) {
+        munmap(base, info.st_size);
+        return -1;
+    }
+
+    reader->version = header->version;
+    reader->mapBase = base;
+    reader->mapLength = info.st_size;
+    if (reader->version == TRACE_VERSION_PACKED) {
+        reader->next = (const uint8_t *)base + sizeof(TraceHeader);
+        reader->end = (const uint8_t *)base + info.st_size;
+        mapIndex(reader);
+        reader->buffer = malloc(TRACE_BUFFER_RECORDS * sizeof(TraceRecord));
+        return reader->buffer != NULL ? 1 : -1;
+    }
+
+    uint64_t available = (info.st_size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    reader->records = (const TraceRecord *)((const uint8_t *)base + sizeof(TraceHeader));
+    reader->remaining = (header->count != 0 && header->count < available) ? header->count : available;
+    reader->total = reader->remaining;
+    return 1;
+}
+
+int openTrace(TraceReader *reader, const char *path) {
+    TraceHeader header;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (reader->file == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    int mapped = mapTrace(reader, path);
+    if (mapped < 0) {
+        closeTrace(reader);
+        return -1;
+    }
+    if (mapped)
+        return 0;
+
+    /* pipes and other non-mappable inputs are streamed through a buffer */
+    if (fread(&header, sizeof(header), 1, reader->file) != 1 || checkHeader(&header, path) != 0) {
+        closeTrace(reader);
+        return -1;
+    }
+    reader->version = header.version;
+    reader->buffer = malloc(TRACE_BUFFER_RECORDS * sizeof(TraceRecord));
+    if (reader->version == TRACE_VERSION_PACKED)
+        reader->payload = malloc(MAX_CHUNK_BYTES);
+    if (reader->buffer == NULL || (reader->version == TRACE_VERSION_PACKED && reader->payload == NULL)) {
+        closeTrace(reader);
+        return -1;
+    }
+    return 0;
+}
+
+/* The next packed chunk, decoded into reader->buffer; 0 at the end marker,
+   the end of the input or a damaged chunk (which is reported) */
+static size_t nextPackedChunk(TraceReader *reader) {
+    TraceChunkHeader chunk;
+    const uint8_t *payload;
+
+    if (reader->mapBase != NULL) {
+        if ((size_t)(reader->end - reader->next) < sizeof(chunk))
+            return 0;
+        memcpy(&chunk, reader->next, sizeof(chunk));
+        payload = reader->next + sizeof(chunk);
+        if (chunk.bytes > (size_t)(reader->end - payload))
+            chunk.records = TRACE_BUFFER_RECORDS + 1;       // reported below
+        else
+            reader->next = payload + chunk.bytes;
+    } else {
+        if (fread(&chunk, sizeof(chunk), 1, reader->file) != 1)
+            return 0;
+        if (chunk.bytes > MAX_CHUNK_BYTES || fread(reader->payload, 1, chunk.bytes, reader->file) != chunk.bytes)
+            chunk.records = TRACE_BUFFER_RECORDS + 1;
+        payload = reader->payload;
+    }
+    if (chunk.records == 0)
+        return 0;
+    if (chunk.records > TRACE_BUFFER_RECORDS || unpackChunk(payload, chunk.bytes, chunk.records, reader->buffer) != 0) {
+        fprintf(stderr, "trace: damaged chunk\n");
+        reader->next = reader->end;
+        return 0;
+    }
+    return chunk.records;
+}
+
+/* Hands out the next batch of records through *records and returns its size,
+   0 at the end of the trace. The batch stays valid until the next call. */
+size_t nextTraceRecords(TraceReader *reader, const TraceRecord **records) {
+    if (reader->version == TRACE_VERSION_PACKED) {
+        size_t count = nextPackedChunk(reader);
+        size_t skip = reader->skip < count ? reader->skip : count;   // into the chunk a seek landed in
+        reader->skip = 0;
+        *records = reader->buffer + skip;
+        return count - skip;
+    }
+    if (reader->mapBase != NULL) {
+        size_t count = reader->remaining < TRACE_BUFFER_RECORDS ? reader->remaining : TRACE_BUFFER_RECORDS;
+        *records = reader->records;
+        reader->records += count;
+        reader->remaining -= count;
+        return count;
+    }
+
+    size_t count = fread(reader->buffer, sizeof(TraceRecord), TRACE_BUFFER_RECORDS, reader->file);
+    *records = reader->buffer;
+    return count;
+}
+
+/* Makes record the next one handed out. Needs a mapped file, and for a
+   packed trace its index; returns -1 otherwise or past the end. */
+int seekTrace(TraceReader *reader, uint64_t record) {
+    if (reader->mapBase == NULL)
+        return -1;
+    if (reader->version != TRACE_VERSION_PACKED) {
+        if (record > reader->total)
+            return -1;
+        reader->records = (const TraceRecord *)((const uint8_t *)reader->mapBase + sizeof(TraceHeader)) + record;
+        reader->remaining = reader->total - record;
+        return 0;
+    }
+    if (reader->index == NULL || reader->chunks == 0 || record < reader->index[0].first)
+        return -1;
+
+    uint32_t low = 0, high = reader->chunks - 1;       // last chunk starting at or before record
+    while (low < high) {
+        uint32_t middle = (low + high + 1) / 2;
+        if (reader->index[middle].first <= record)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    if (reader->index[low].offset >= (uint64_t)(reader->end - (const uint8_t *)reader->mapBase))
+        return -1;
+    reader->next = (const uint8_t *)reader->mapBase + reader->index[low].offset;
+    reader->skip = record - reader->index[low].first;
+    return 0;
+}
+
+void closeTrace(TraceReader *reader) {
+    if (reader->mapBase != NULL)
+        munmap(reader->mapBase, reader->mapLength);
+    if (reader->file != NULL && reader->file != stdin)
+        fclose(reader->file);
+    free(reader->buffer);
+    free(reader->payload);
+    memset(reader, 0, sizeof(*reader));
+}
+
+/*********************** Writing *************************/
+
+/* Undoes a partly opened writer, as closeTrace does for a reader */
+static void discardTraceWriter(TraceWriter *writer) {
+    if (writer->file != NULL && writer->file != stdout)
+        fclose(writer->file);
+    free(writer->pending);
+    free(writer->payload);
+    memset(writer, 0, sizeof(*writer));
+}
+
+static int openTraceWriter(TraceWriter *writer, const char *path, uint32_t version) {
+    TraceHeader header = { TRACE_MAGIC, version, 0 };
+
+    memset(writer, 0, sizeof(*writer));
+    writer->version = version;
+    if (version == TRACE_VERSION_PACKED) {
+        writer->pending = malloc(TRACE_BUFFER_RECORDS * sizeof(TraceRecord));
+        writer->payload = malloc(MAX_CHUNK_BYTES);
+        if (writer->pending == NULL || writer->payload == NULL) {
+            discardTraceWriter(writer);
+            return -1;
+        }
+    }
+    writer->file = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+    if (writer->file == NULL) {
+        perror(path);
+        discardTraceWriter(writer);
+        return -1;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, 1 << 20);
+
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        perror(path);
+        discardTraceWriter(writer);
+        return -1;
+    }
+    writer->offset = sizeof(header);
+    return 0;
+}
+
+int createTrace(TraceWriter *writer, const char *path) {
+    return openTraceWriter(writer, path, TRACE_VERSION);
+}
+
+/* The same, for a version 2 (packed) trace */
+int createPackedTrace(TraceWriter *writer, const char *path) {
+    return openTraceWriter(writer, path, TRACE_VERSION_PACKED);
+}
+
+/* Writes out the pending records as a chunk and indexes it */
+static int flushChunk(TraceWriter *writer) {
+    TraceChunkHeader chunk;
+
+    if (writer->pendingCount == 0)
+        return 0;
+    if (writer->chunks == writer->indexCapacity) {
+        uint32_t capacity = writer->indexCapacity ? 2 * writer->indexCapacity : 256;
+        TraceIndexEntry *index = realloc(writer->index, capacity * sizeof(TraceIndexEntry));
+        if (index == NULL)
+            return -1;
+        writer->index = index;
+        writer->indexCapacity = capacity;
+    }
+    writer->index[writer->chunks].offset = writer->offset;
+    writer->index[writer->chunks].first = writer->count - writer->pendingCount;
+    writer->chunks++;
+
+    chunk.records = writer->pendingCount;
+    chunk.bytes = packChunk(writer->pending, writer->pendingCount, writer->payload);
+    if (fwrite(&chunk, sizeof(chunk), 1, writer->file) != 1 ||
+        fwrite(writer->payload, 1, chunk.bytes, writer->file) != chunk.bytes)
+        return -1;
+    writer->offset += sizeof(chunk) + chunk.bytes;
+    writer->pendingCount = 0;
+    return 0;
+}
+
+int appendTraceRecord(TraceWriter *writer, uint64_t address, uint8_t mode, uint8_t size, uint8_t core) {
+    TraceRecord record;
+
+    memset(&record, 0, sizeof(record));
+    record.address = address;
+    record.mode = mode;
+    record.size = size;
+    record.core = core;
+
+    writer->count++;
+    if (writer->version == TRACE_VERSION_PACKED) {
+        writer->pending[writer->pendingCount++] = record;
+        return writer->pendingCount == TRACE_BUFFER_RECORDS ? flushChunk(writer) : 0;
+    }
+    if (fwrite(&record, sizeof(record), 1, writer->file) != 1)
+        return -1;
+    return 0;
+}
+
+/* The last chunk, the end marker and the index, aligned for mapping */
+static int finishPackedTrace(TraceWriter *writer) {
+    TraceChunkHeader end = { 0, 0 };
+    TraceFooter footer;
+    uint64_t zero = 0;
+    uint32_t padding;
+
+    if (flushChunk(writer) != 0 || fwrite(&end, sizeof(end), 1, writer->file) != 1)
+        return -1;
+    writer->offset += sizeof(end);
+    padding = (uint32_t)((sizeof(uint64_t) - writer->offset % sizeof(uint64_t)) % sizeof(uint64_t));
+    footer.indexOffset = writer->offset + padding;
+    footer.chunks = writer->chunks;
+    footer.magic = TRACE_INDEX_MAGIC;
+    if (fwrite(&zero, 1, padding, writer->file) != padding ||
+        fwrite(writer->index, sizeof(TraceIndexEntry), writer->chunks, writer->file) != writer->chunks ||
+        fwrite(&footer, sizeof(footer), 1, writer->file) != 1)
+        return -1;
+    return 0;
+}
+
+/* Patches the record count into the header when the output is seekable */
+int closeTraceWriter(TraceWriter *writer) {
+    TraceHeader header = { TRACE_MAGIC, writer->version, writer->count };
+    int status = 0;
+
+    if (writer->version == TRACE_VERSION_PACKED) {
+        status = finishPackedTrace(writer);
+        free(writer->pending);
+        free(writer->payload);
+        free(writer->index);
+        writer->pending = NULL;
+        writer->payload = NULL;
+        writer->index = NULL;
+    }
+
+    if (fflush(writer->file) != 0)                 // fseek would flush too, but a failure there reads as unseekable
+        status = -1;
+    if (fseek(writer->file, 0, SEEK_SET) == 0) {
+        if (fwrite(&header, sizeof(header), 1, writer->file) != 1)
+            status = -1;
+    }
+    if (writer->file != stdout) {
+        if (fclose(writer->file) != 0)
+            status = -1;
+    } else if (fflush(writer->file) != 0) {
+        status = -1;
+    }
+    writer->file = NULL;
+    return status;
+}
@@ -0,0 +1,115 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Binary trace file, all little endian. The mode encoding matches
+ * MODE_READ / MODE_WRITE in Cache.h. Two layouts share the TraceHeader:
+ *
+ * Version 1: fixed size TraceRecords, 16 bytes each.
+ *
+ * Version 2 (packed): chunks of up to TRACE_BUFFER_RECORDS records, each a
+ * TraceChunkHeader and its payload:
+ *   - a bitmap of the record modes, 1 = TRACE_MODE_READ,
+ *   - a bitmap of the records whose size or core differ from the previous one,
+ *   - per record, the zigzag encoded difference to the previous address as a
+ *     LEB128 varint, followed by the size and core bytes if it is marked.
+ * Every chunk starts over from address 0, size 4 and core 0, so it decodes on
+ * its own. An empty chunk ends the data; after it come one TraceIndexEntry
+ * per chunk and a TraceFooter, which let a mapped reader seek to any record.
+ * A sequential word stream costs about one byte per access.
+ */
+
+#define TRACE_MAGIC 0x5254434f      // "OCTR"
+#define TRACE_VERSION 1
+#define TRACE_VERSION_PACKED 2
+#define TRACE_INDEX_MAGIC 0x58444e49    // "INDX"
+#define TRACE_BUFFER_RECORDS 65536  // records per buffered read (1 MiB), and per packed chunk
+
+#define TRACE_MODE_READ 1
+#define TRACE_MODE_WRITE 0
+
+typedef struct TraceHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t count;   // number of records, 0 if unknown (read until EOF)
+} TraceHeader;
+
+typedef struct TraceRecord {
+  uint64_t address;
+  uint8_t mode;
+  uint8_t size;     // access size in bytes
+  uint8_t core;     // issuing core, 0 for single core traces
+  uint8_t reserved[5];
+} TraceRecord;
+
+typedef struct TraceChunkHeader {
+  uint32_t records;   // 0 ends the chunks
+  uint32_t bytes;     // payload that follows
+} TraceChunkHeader;
+
+typedef struct TraceIndexEntry {
+  uint64_t offset;    // of the chunk header in the file
+  uint64_t first;     // number of its first record
+} TraceIndexEntry;
+
+typedef struct TraceFooter {
+  uint64_t indexOffset;
+  uint32_t chunks;
+  uint32_t magic;     // TRACE_INDEX_MAGIC
+} TraceFooter;
+
+typedef struct TraceReader {
+  FILE *file;
+  uint32_t version;
+  void *mapBase;                  // whole file when mmap'd, NULL otherwise
+  size_t mapLength;
+  const TraceRecord *records;     // next records to hand out (version 1)
+  uint64_t remaining;             // records left in the mapping (version 1)
+  uint64_t total;                 // records in the mapping (version 1)
+  const uint8_t *next;            // next chunk in the mapping (version 2)
+  const uint8_t *end;
+  const TraceIndexEntry *index;   // in the mapping, NULL if the trace has none
+  uint32_t chunks;
+  uint64_t skip;                  // records to drop from the next chunk after a seek
+  TraceRecord *buffer;            // fallback buffer when mmap is not possible, decoded chunks
+  uint8_t *payload;               // a packed chunk read from a stream
+} TraceReader;
+
+typedef struct TraceWriter {
+  FILE *file;
+  uint64_t count;
+  uint32_t version;
+  TraceRecord *pending;           // the chunk being filled (version 2)
+  uint32_t pendingCount;
+  uint8_t *payload;
+  uint64_t offset;                // bytes written so far
+  TraceIndexEntry *index;
+  uint32_t chunks;
+  uint32_t indexCapacity;
+} TraceWriter;
+
+/*********************** Reading *************************/
+
+int openTrace(TraceReader *, const char *);
+
+size_t nextTraceRecords(TraceReader *, const TraceRecord **);
+
+int seekTrace(TraceReader *, uint64_t);
+
+void closeTrace(TraceReader *);
+
+/*********************** Writing *************************/
+
+int createTrace(TraceWriter *, const char *);
+
+int createPackedTrace(TraceWriter *, const char *);
+
+int appendTraceRecord(TraceWriter *, uint64_t, uint8_t, uint8_t, uint8_t);
+
+int closeTraceWriter(TraceWriter *);
+
+#endif
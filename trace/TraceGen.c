@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Trace.h"
+
+/*
+ * Writes synthetic traces for the replay programs, packed (version 2) with -p:
+ *   TraceGen [-p] <file> sweep <words>            write then read <words> consecutive words
+ *   TraceGen <file> random <count> <bytes> [seed] <count> random word accesses below <bytes>
+ *   TraceGen <file> sharing <count> <cores> <stride>
+ *                     every core in turn reads then writes its own counter,
+ *                     <stride> bytes apart; below the block size the counters
+ *                     share a block and ping-pong between the L1s (false sharing)
+ *   TraceGen <file> convert <trace>...            copy other traces one after the other,
+ *                                                 e.g. to pack, unpack or join them
+ *   TraceGen <file> text <listing>                one word access per line of listing ("-" for stdin):
+ *                                                 r or w, the address, optionally the core;
+ *                                                 blank lines and lines starting with # are skipped
+ */
+
+#define WORD_SIZE 4
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s [-p] <file> sweep <words>\n", name);
+  fprintf(stderr, "       %s [-p] <file> random <count> <bytes> [seed]\n", name);
+  fprintf(stderr, "       %s [-p] <file> sharing <count> <cores> <stride>\n", name);
+  fprintf(stderr, "       %s [-p] <file> convert <trace>...\n", name);
+  fprintf(stderr, "       %s [-p] <file> text <listing>\n", name);
+  exit(-1);
+}
+
+int main(int argc, char **argv) {
+
+  TraceWriter writer;
+  int status = 0, packed = 0;
+  const char *name = argv[0];
+
+  if (argc > 1 && strcmp(argv[1], "-p") == 0) {
+    packed = 1;
+    argc--;
+    argv++;
+  }
+  if (argc < 4)
+    usage(name);
+
+  if ((packed ? createPackedTrace(&writer, argv[1]) : createTrace(&writer, argv[1])) != 0)
+    return -1;
+
+  if (strcmp(argv[2], "sweep") == 0) {
+    uint64_t words = strtoull(argv[3], NULL, 0);
+    for (uint64_t i = 0; i < words; i++)
+      status |= appendTraceRecord(&writer, i * WORD_SIZE, TRACE_MODE_WRITE, WORD_SIZE, 0);
+    for (uint64_t i = 0; i < words; i++)
+      status |= appendTraceRecord(&writer, i * WORD_SIZE, TRACE_MODE_READ, WORD_SIZE, 0);
+  }
+  else if (strcmp(argv[2], "random") == 0 && argc >= 5) {
+    uint64_t count = strtoull(argv[3], NULL, 0);
+    uint64_t bytes = strtoull(argv[4], NULL, 0);
+    srand(argc > 5 ? atoi(argv[5]) : 0);
+    if (bytes < WORD_SIZE)
+      usage(name);
+    for (uint64_t i = 0; i < count; i++) {
+      uint64_t address = (((uint64_t)rand() << 31) | rand()) % bytes;
+      address = address - address % WORD_SIZE;
+      status |= appendTraceRecord(&writer, address, rand() % 2 ? TRACE_MODE_READ : TRACE_MODE_WRITE, WORD_SIZE, 0);
+    }
+  }
+  else if (strcmp(argv[2], "sharing") == 0 && argc >= 6) {
+    uint64_t count = strtoull(argv[3], NULL, 0);
+    uint32_t cores = (uint32_t)strtoul(argv[4], NULL, 0);
+    uint64_t stride = strtoull(argv[5], NULL, 0);
+    if (cores == 0 || cores > 255 || stride < WORD_SIZE)
+      usage(name);
+    for (uint64_t i = 0; i < count; i++) {
+      for (uint32_t core = 0; core < cores; core++) {
+        status |= appendTraceRecord(&writer, core * stride, TRACE_MODE_READ, WORD_SIZE, (uint8_t)core);
+        status |= appendTraceRecord(&writer, core * stride, TRACE_MODE_WRITE, WORD_SIZE, (uint8_t)core);
+      }
+    }
+  }
+  else if (strcmp(argv[2], "convert") == 0) {
+    for (int t = 3; t < argc; t++) {
+      TraceReader reader;
+      const TraceRecord *records;
+      size_t count;
+      if (openTrace(&reader, argv[t]) != 0)
+        return -1;
+      while ((count = nextTraceRecords(&reader, &records)) > 0)
+        for (size_t r = 0; r < count; r++)
+          status |= appendTraceRecord(&writer, records[r].address, records[r].mode, records[r].size, records[r].core);
+      closeTrace(&reader);
+    }
+  }
+  else if (strcmp(argv[2], "text") == 0) {
+    FILE *in = strcmp(argv[3], "-") == 0 ? stdin : fopen(argv[3], "r");
+    char line[256], mode;
+    unsigned long long address;
+    unsigned core;
+    if (in == NULL) {
+      perror(argv[3]);
+      return -1;
+    }
+    while (fgets(line, sizeof(line), in) != NULL) {
+      core = 0;
+      int fields = sscanf(line, " %c %lli %u", &mode, &address, &core);
+      if (fields < 1 || mode == '#')
+        continue;
+      if (fields < 2 || (mode != 'r' && mode != 'w') || core > 255) {
+        fprintf(stderr, "%s: bad line: %s", argv[3], line);
+        return -1;
+      }
+      status |= appendTraceRecord(&writer, address, mode == 'r' ? TRACE_MODE_READ : TRACE_MODE_WRITE, WORD_SIZE,
+                                  (uint8_t)core);
+    }
+    if (in != stdin)
+      fclose(in);
+  }
+  else {
+    usage(name);
+  }
+
+  status |= closeTraceWriter(&writer);
+  if (status != 0) {
+    fprintf(stderr, "%s: write failed\n", argv[1]);
+    return -1;
+  }
+  return 0;
+}